@@ -4,11 +4,13 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/select.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "console.h"
@@ -26,9 +28,28 @@ static bool prompt_flag = true;
 /* Am I timing a command that has the console blocked? */
 static bool block_timing = false;
 
-/* Time of day */
+/* Readings of the timer of the time command */
 static double first_time, last_time;
 
+/* Latencies of every command run through interpret_cmda(), in nanoseconds,
+ * are counted in log-linear buckets like in HdrHistogram.  Values below
+ * LAT_SUB have a bucket each, and each further power of two is split into
+ * LAT_SUB buckets, so a percentile read from the histogram is within
+ * 1 / LAT_SUB of the exact one.  Values from 2^LAT_MAX_BITS ns on share the
+ * last bucket.
+ */
+#define LAT_SUB_BITS 4
+#define LAT_SUB (1 << LAT_SUB_BITS)
+#define LAT_MAX_BITS 48
+#define LAT_BUCKETS ((LAT_MAX_BITS - LAT_SUB_BITS + 1) * LAT_SUB)
+
+typedef struct __cmd_stats {
+    uint64_t count;
+    uint64_t total; /* Sum of the latencies */
+    uint64_t max;
+    uint64_t buckets[LAT_BUCKETS];
+} cmd_stats_t;
+
 /* Implement buffered I/O using variant of RIO package from CS:APP
  * Must create stack of buffers to handle I/O with nested source commands.
  */
@@ -87,6 +108,7 @@ void add_cmd(char *name, cmd_func_t operation, char *summary, char *param)
     cmd->operation = operation;
     cmd->summary = summary;
     cmd->param = param;
+    cmd->stats = NULL;
     cmd->next = next_cmd;
     *last_loc = cmd;
 }
@@ -167,6 +189,68 @@ static void record_error()
     }
 }
 
+/* Current time of the monotonic clock in nanoseconds */
+static inline uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Histogram bucket counting a latency of ns nanoseconds */
+static size_t lat_bucket(uint64_t ns)
+{
+    if (ns < LAT_SUB)
+        return ns;
+
+    int e = 63 - __builtin_clzll(ns);
+    if (e >= LAT_MAX_BITS)
+        return LAT_BUCKETS - 1;
+    return (size_t) (e - LAT_SUB_BITS + 1) * LAT_SUB +
+           (ns >> (e - LAT_SUB_BITS)) - LAT_SUB;
+}
+
+/* Highest latency counted in bucket i */
+static uint64_t lat_value(size_t i)
+{
+    if (i < LAT_SUB)
+        return i;
+
+    int e = i / LAT_SUB + LAT_SUB_BITS - 1;
+    uint64_t sub = i % LAT_SUB + LAT_SUB;
+    return ((sub + 1) << (e - LAT_SUB_BITS)) - 1;
+}
+
+/* Add one call of cmd taking ns nanoseconds to its statistics */
+static void record_latency(cmd_element_t *cmd, uint64_t ns)
+{
+    if (!cmd->stats)
+        cmd->stats = calloc_or_fail(1, sizeof(cmd_stats_t), "record_latency");
+
+    cmd_stats_t *stats = cmd->stats;
+    stats->count++;
+    stats->total += ns;
+    if (ns > stats->max)
+        stats->max = ns;
+    stats->buckets[lat_bucket(ns)]++;
+}
+
+/* Latency below which a fraction q of the calls fall */
+static uint64_t lat_percentile(const cmd_stats_t *stats, double q)
+{
+    uint64_t rank = q * stats->count, seen = 0;
+
+    /* Round the rank up, so that it is at least 1 */
+    if (rank < q * stats->count || !rank)
+        rank++;
+    for (size_t i = 0; i < LAT_BUCKETS; i++) {
+        seen += stats->buckets[i];
+        if (seen >= rank)
+            return lat_value(i) < stats->max ? lat_value(i) : stats->max;
+    }
+    return stats->max;
+}
+
 /* Execute a command that has already been split into arguments */
 static bool interpret_cmda(int argc, char *argv[])
 {
@@ -178,7 +262,11 @@ static bool interpret_cmda(int argc, char *argv[])
     while (next_cmd && strcmp(argv[0], next_cmd->name) != 0)
         next_cmd = next_cmd->next;
     if (next_cmd) {
+        uint64_t start = now_ns();
         ok = next_cmd->operation(argc, argv);
+        /* The commands are gone once quit has run */
+        if (!quit_flag)
+            record_latency(next_cmd, now_ns() - start);
         if (!ok)
             record_error();
     } else {
@@ -229,6 +317,8 @@ static bool do_quit(int argc, char *argv[])
     while (c) {
         cmd_element_t *ele = c;
         c = c->next;
+        if (ele->stats)
+            free_block(ele->stats, sizeof(cmd_stats_t));
         free_block(ele, sizeof(cmd_element_t));
     }
 
@@ -391,6 +481,93 @@ static bool do_time(int argc, char *argv[])
     return ok;
 }
 
+/* Format a latency with a unit fitting its magnitude */
+static char *format_ns(char *buf, size_t size, uint64_t ns)
+{
+    if (ns < 10000)
+        snprintf(buf, size, "%lu ns", (unsigned long) ns);
+    else if (ns < 10000000)
+        snprintf(buf, size, "%.1f us", ns / 1e3);
+    else if (ns < 10000000000)
+        snprintf(buf, size, "%.1f ms", ns / 1e6);
+    else
+        snprintf(buf, size, "%.1f s", ns / 1e9);
+    return buf;
+}
+
+/* Print the latencies of the commands run so far as JSON */
+static bool stats_json(FILE *out)
+{
+    bool first = true;
+
+    fprintf(out, "{\n  \"unit\": \"ns\",\n  \"commands\": {");
+    for (cmd_element_t *c = cmd_list; c; c = c->next) {
+        const cmd_stats_t *stats = c->stats;
+        if (!stats || !stats->count)
+            continue;
+        fprintf(out,
+                "%s\n    \"%s\": {\"calls\": %lu, \"total\": %lu, "
+                "\"p50\": %lu, \"p99\": %lu, \"p999\": %lu, \"max\": %lu}",
+                first ? "" : ",", c->name, (unsigned long) stats->count,
+                (unsigned long) stats->total,
+                (unsigned long) lat_percentile(stats, 0.5),
+                (unsigned long) lat_percentile(stats, 0.99),
+                (unsigned long) lat_percentile(stats, 0.999),
+                (unsigned long) stats->max);
+        first = false;
+    }
+    fprintf(out, "\n  }\n}\n");
+    return !ferror(out);
+}
+
+static bool do_stats(int argc, char *argv[])
+{
+    if (argc == 2 && !strcmp(argv[1], "reset")) {
+        for (cmd_element_t *c = cmd_list; c; c = c->next) {
+            if (c->stats)
+                memset(c->stats, 0, sizeof(cmd_stats_t));
+        }
+        return true;
+    }
+
+    if ((argc == 2 || argc == 3) && !strcmp(argv[1], "json")) {
+        if (argc == 2) {
+            fflush(stdout);
+            return stats_json(stdout);
+        }
+        FILE *out = fopen(argv[2], "w");
+        if (!out) {
+            report(1, "Couldn't open stats file '%s'", argv[2]);
+            return false;
+        }
+        bool ok = stats_json(out);
+        return fclose(out) == 0 && ok;
+    }
+
+    if (argc != 1) {
+        report(1, "%s takes no arguments other than reset or json [file]",
+               argv[0]);
+        return false;
+    }
+
+    report(1, "%-12s %10s %10s %10s %10s %10s", "Command", "Calls", "p50",
+           "p99", "p99.9", "Max");
+    for (cmd_element_t *c = cmd_list; c; c = c->next) {
+        const cmd_stats_t *stats = c->stats;
+        char p50[32], p99[32], p999[32], max[32];
+
+        if (!stats || !stats->count)
+            continue;
+        report(1, "%-12s %10lu %10s %10s %10s %10s", c->name,
+               (unsigned long) stats->count,
+               format_ns(p50, sizeof(p50), lat_percentile(stats, 0.5)),
+               format_ns(p99, sizeof(p99), lat_percentile(stats, 0.99)),
+               format_ns(p999, sizeof(p999), lat_percentile(stats, 0.999)),
+               format_ns(max, sizeof(max), stats->max));
+    }
+    return true;
+}
+
 static bool use_linenoise = true;
 static int web_fd;
 
@@ -430,6 +607,10 @@ void init_cmd()
     ADD_COMMAND(source, "Read commands from source file", "");
     ADD_COMMAND(log, "Copy output to file", "file");
     ADD_COMMAND(time, "Time command execution", "cmd arg ...");
+    ADD_COMMAND(stats,
+                "Show latency percentiles of the commands run, export them as "
+                "JSON, or restart counting",
+                "[reset | json [file]]");
     ADD_COMMAND(web, "Read commands from builtin web server", "[port]");
     add_cmd("#", do_comment_cmd, "Display comment", "...");
     add_param("simulation", &simulation, "Start/Stop simulation mode", NULL);
@@ -16,6 +16,9 @@ extern int simulation;
 /* Each command defined in terms of a function */
 typedef bool (*cmd_func_t)(int argc, char *argv[]);
 
+/* Latency histogram of a command, kept by the console */
+struct __cmd_stats;
+
 /* Information about each command */
 
 /* Organized as linked list in alphabetical order */
@@ -24,6 +27,7 @@ typedef struct __cmd_element {
     cmd_func_t operation;
     char *summary;
     char *param;
+    struct __cmd_stats *stats; /* NULL until the command first runs */
     struct __cmd_element *next;
 } cmd_element_t;
 
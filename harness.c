@@ -1,10 +1,15 @@
 /* Test support code */
 
+#include <pthread.h>
 #include <setjmp.h>
 #include <signal.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 #include "report.h"
@@ -18,6 +23,9 @@
 /* Value at start of every allocated block */
 #define MAGICHEADER 0xdeadbeef
 
+/* Value at start of every block allocated in guard mode */
+#define MAGICGUARD 0xfeedbeef
+
 /* Value when deallocate block */
 #define MAGICFREE 0xffffffff
 
@@ -29,48 +37,366 @@
 
 /* Data structures used by our code */
 
-/* Represent allocated blocks as doubly-linked list, with
- * next and prev pointers at beginning
- */
+/* Header placed in front of every allocated block */
 typedef struct __block_element {
-    struct __block_element *next, *prev;
     size_t payload_size;
+    size_t site;         /* Index of the allocating call site in sites[] */
+    uint64_t birth;      /* Value of alloc_clock when allocated */
     size_t magic_header; /* Marker to see if block seems legitimate */
     unsigned char payload[0];
     /* Also place magic number at tail of every block */
 } block_element_t;
 
-static block_element_t *allocated = NULL;
-static size_t allocated_count = 0;
+/* Blocks placed before a guard page keep the payload aligned */
+_Static_assert(sizeof(block_element_t) % _Alignof(max_align_t) == 0,
+               "block header breaks the alignment of the payload");
+
+/* The harness may be used from several threads at once.  Counters shared by
+ * all threads are atomic, each thread keeps the blocks it allocates in its own
+ * live set, and each thread has its own exception context.
+ */
+static atomic_size_t allocated_count = 0;
+
+/* Place each block right before a page which is not accessible */
+int guard_mode = 0;
+
+/* Largest payload filled with FILLCHAR, -1 for no limit */
+int fill_limit = -1;
+
+/* Blocks freed in guard mode stay inaccessible in a FIFO of mappings, so
+ * that using them after free faults.  Once the quarantine is full, the
+ * oldest mapping is reused by the next block of the same number of pages,
+ * or unmapped.
+ */
+#define QUARANTINE_SIZE 1024
+
+typedef struct {
+    char *base;
+    size_t pages; /* Number of pages before the guard page */
+} guard_map_t;
+
+static pthread_mutex_t quarantine_lock = PTHREAD_MUTEX_INITIALIZER;
+static guard_map_t quarantine[QUARANTINE_SIZE];
+static size_t quarantine_head = 0;
+static size_t quarantine_count = 0;
+static size_t page_size = 0;
+
+/* Number of blocks allocated so far, which serves as the clock measuring the
+ * lifetime of blocks.
+ */
+static _Atomic uint64_t alloc_clock = 0;
+
+/* Allocation statistics of one call site of test_malloc(), counted since the
+ * last reset.  Sites are told apart by the __FILE__ and __LINE__ the macros of
+ * harness.h pass.  Site 0 collects the calls without a known site, and the
+ * calls from new sites once the table is full.
+ */
+typedef struct {
+    const char *file;
+    int line;
+    atomic_size_t allocs, frees;
+    atomic_size_t bytes;            /* Total bytes allocated */
+    atomic_size_t live, live_bytes; /* Blocks allocated but not freed yet */
+    atomic_size_t peak_bytes;       /* Highest value of live_bytes */
+    _Atomic uint64_t lifetime;      /* Sum of the lifetimes of freed blocks */
+} alloc_site_t;
+
+#define SITE_MAX 256
+#define SITE_SLOTS (2 * SITE_MAX) /* Power of two */
+
+static alloc_site_t sites[SITE_MAX] = {{.file = "(unknown)"}};
+static atomic_size_t site_count = 1;
+
+/* Hash table mapping call sites to their index in sites[], 0 if empty.
+ * Lookups do not lock, and new sites are added under sites_lock.
+ */
+static _Atomic uint16_t site_slots[SITE_SLOTS];
+static pthread_mutex_t sites_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Live blocks are kept in open-addressing hash sets with linear probing,
+ * so that validating a block to be freed takes constant expected time no
+ * matter how many blocks are allocated.  The capacity is a power of two and
+ * a set is kept at most half full.
+ *
+ * Every thread inserts the blocks it allocates in its own set, whose lock is
+ * only contended when another thread frees one of them.  The sets are never
+ * freed: the set of a thread which exited is taken over by the next new
+ * thread, together with the blocks still in it.
+ */
+#define LIVE_SET_MIN 1024
+
+typedef struct __live_set {
+    pthread_mutex_t lock;
+    block_element_t **slots;
+    size_t capacity;
+    size_t count;
+    bool active;             /* Owned by a running thread */
+    struct __live_set *next; /* In the list of all sets */
+} live_set_t;
+
+static live_set_t *live_sets = NULL;
+static pthread_mutex_t live_sets_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t live_key;
+static pthread_once_t live_key_once = PTHREAD_ONCE_INIT;
+static _Thread_local live_set_t *my_live_set = NULL;
 
 /* Percent probability of malloc failure */
 int fail_probability = 0;
 
+/* Deterministic failure schedules, 0 for none */
+int fail_every = 0;
+int fail_nth = 0;
+
+/* Seed of the random failures, 0 for a seed drawn from random() */
+int fail_seed = 0;
+
+/* Fault injection state derived from the params above by fault_update().
+ * A 32-bit draw below fault_threshold fails an allocation, and fault_clock
+ * numbers the allocations made since the params were last set.
+ */
+static bool fault_enabled = false;
+static uint64_t fault_threshold = 0;
+static _Atomic uint64_t fault_state = 1;
+static atomic_ulong fault_clock = 0;
+
 static bool cautious_mode = true;
 static bool noallocate_mode = false;
-static bool error_occurred = false;
-static char *error_message = "";
+static atomic_bool error_occurred = false;
+static _Thread_local char *error_message = "";
 
 static int time_limit = 1;
 
-/* Data for managing exceptions */
-static jmp_buf env;
-static volatile sig_atomic_t jmp_ready = false;
-static bool time_limited = false;
+/* Data for managing exceptions, one context per thread */
+static _Thread_local sigjmp_buf env;
+static _Thread_local volatile sig_atomic_t jmp_ready = false;
+static _Thread_local bool time_limited = false;
 
 /* Internal functions */
 
+/* Next draw of the xorshift64* generator of fault injection */
+static inline uint32_t fault_next()
+{
+    uint64_t x = atomic_load_explicit(&fault_state, memory_order_relaxed), y;
+
+    do {
+        y = x ^ (x >> 12);
+        y ^= y << 25;
+        y ^= y >> 27;
+    } while (!atomic_compare_exchange_weak_explicit(
+        &fault_state, &x, y, memory_order_relaxed, memory_order_relaxed));
+    return (y * 0x2545f4914f6cdd1dULL) >> 32;
+}
+
+static bool fail_scheduled()
+{
+    unsigned long n = atomic_fetch_add(&fault_clock, 1) + 1;
+
+    if (fail_every > 0 && n % fail_every == 0)
+        return true;
+    if (fail_nth > 0 && n == (unsigned long) fail_nth)
+        return true;
+    return fault_threshold && fault_next() < fault_threshold;
+}
+
 /* Should this allocation fail? */
-static bool fail_allocation()
+static inline bool fail_allocation()
+{
+    if (__glibc_likely(!fault_enabled))
+        return false;
+    return fail_scheduled();
+}
+
+/* Return the index of the call site in sites[], adding it if it is new */
+static size_t site_find(const char *file, int line)
+{
+    if (!file)
+        return 0;
+
+    uint64_t x = (uintptr_t) file ^ ((uint64_t) line << 32);
+    size_t home = (x * 0x9e3779b97f4a7c15ULL) >> 32, i, n;
+    for (i = home & (SITE_SLOTS - 1); (n = site_slots[i]);
+         i = (i + 1) & (SITE_SLOTS - 1)) {
+        if (sites[n].file == file && sites[n].line == line)
+            return n;
+    }
+
+    /* Look again under the lock, in case another thread added the site */
+    pthread_mutex_lock(&sites_lock);
+    for (i = home & (SITE_SLOTS - 1); (n = site_slots[i]);
+         i = (i + 1) & (SITE_SLOTS - 1)) {
+        if (sites[n].file == file && sites[n].line == line)
+            break;
+    }
+    if (!n && site_count < SITE_MAX) {
+        n = site_count;
+        sites[n].file = file;
+        sites[n].line = line;
+        /* Publish the site only once it is filled in */
+        site_slots[i] = n;
+        site_count = n + 1;
+    }
+    pthread_mutex_unlock(&sites_lock);
+    return n;
+}
+
+/* Raise the maximum kept in *max to b */
+static inline void atomic_max(atomic_size_t *max, size_t b)
+{
+    size_t m = atomic_load_explicit(max, memory_order_relaxed);
+
+    while (b > m && !atomic_compare_exchange_weak_explicit(
+                        max, &m, b, memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+static inline size_t live_hash(const live_set_t *set, const block_element_t *b)
+{
+    /* Fibonacci hashing of the address, ignoring the alignment bits */
+    uint64_t x = (uintptr_t) b >> 4;
+    return (size_t) ((x * 0x9e3779b97f4a7c15ULL) >> 32) & (set->capacity - 1);
+}
+
+/* Return the slot holding b, or set->capacity if b is not in the set */
+static size_t live_find(const live_set_t *set, const block_element_t *b)
+{
+    if (!set->slots)
+        return set->capacity;
+
+    size_t mask = set->capacity - 1;
+    for (size_t i = live_hash(set, b); set->slots[i]; i = (i + 1) & mask) {
+        if (set->slots[i] == b)
+            return i;
+    }
+    return set->capacity;
+}
+
+static void live_insert(live_set_t *set, block_element_t *b)
+{
+    if ((set->count + 1) * 2 > set->capacity) {
+        size_t old_capacity = set->capacity;
+        block_element_t **old_slots = set->slots;
+
+        set->capacity = old_capacity ? old_capacity * 2 : LIVE_SET_MIN;
+        set->slots = calloc(set->capacity, sizeof(block_element_t *));
+        if (!set->slots) {
+            report_event(MSG_FATAL, "Couldn't allocate any more memory");
+            return;
+        }
+
+        set->count = 0;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old_slots[i])
+                live_insert(set, old_slots[i]);
+        }
+        free(old_slots);
+    }
+
+    size_t mask = set->capacity - 1;
+    size_t i = live_hash(set, b);
+    while (set->slots[i])
+        i = (i + 1) & mask;
+    set->slots[i] = b;
+    set->count++;
+}
+
+/* Empty the given slot, shifting back entries of the same probe sequence so
+ * that lookups never stop early at the hole.
+ */
+static void live_remove(live_set_t *set, size_t i)
+{
+    block_element_t **slots = set->slots;
+    size_t mask = set->capacity - 1;
+
+    for (size_t j = (i + 1) & mask; slots[j]; j = (j + 1) & mask) {
+        size_t k = live_hash(set, slots[j]);
+        /* Entry j may move to i unless its home slot k lies in (i, j] */
+        bool stays = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+        if (!stays) {
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+    slots[i] = NULL;
+    set->count--;
+}
+
+/* Called when a thread exits, leaving its blocks to the next new thread */
+static void live_set_release(void *set)
+{
+    pthread_mutex_lock(&live_sets_lock);
+    ((live_set_t *) set)->active = false;
+    pthread_mutex_unlock(&live_sets_lock);
+}
+
+static void live_key_create()
+{
+    pthread_key_create(&live_key, live_set_release);
+}
+
+/* Return the live set of the calling thread */
+static live_set_t *my_set()
+{
+    if (my_live_set)
+        return my_live_set;
+
+    pthread_once(&live_key_once, live_key_create);
+    pthread_mutex_lock(&live_sets_lock);
+    live_set_t *set = live_sets;
+    while (set && set->active)
+        set = set->next;
+    if (!set) {
+        set = calloc(1, sizeof(live_set_t));
+        if (!set) {
+            pthread_mutex_unlock(&live_sets_lock);
+            report_event(MSG_FATAL, "Couldn't allocate any more memory");
+            return NULL;
+        }
+        pthread_mutex_init(&set->lock, NULL);
+        set->next = live_sets;
+        live_sets = set;
+    }
+    set->active = true;
+    pthread_mutex_unlock(&live_sets_lock);
+
+    pthread_setspecific(live_key, set);
+    return my_live_set = set;
+}
+
+/* Find the live set holding b, which is returned locked with the slot of b
+ * stored in *slot.  Return NULL if b is not a live block.
+ */
+static live_set_t *live_locate(const block_element_t *b, size_t *slot)
 {
-    double weight = (double) random() / RAND_MAX;
-    return (weight < 0.01 * fail_probability);
+    live_set_t *mine = my_live_set, *set;
+
+    /* Blocks are most often freed by the thread which allocated them */
+    if (mine) {
+        pthread_mutex_lock(&mine->lock);
+        if ((*slot = live_find(mine, b)) != mine->capacity)
+            return mine;
+        pthread_mutex_unlock(&mine->lock);
+    }
+
+    pthread_mutex_lock(&live_sets_lock);
+    for (set = live_sets; set; set = set->next) {
+        if (set == mine)
+            continue;
+        pthread_mutex_lock(&set->lock);
+        if ((*slot = live_find(set, b)) != set->capacity)
+            break;
+        pthread_mutex_unlock(&set->lock);
+    }
+    pthread_mutex_unlock(&live_sets_lock);
+    return set;
 }
 
 /* Find header of block, given its payload.
- * Signal error if doesn't seem like legitimate block
+ * Signal error if doesn't seem like legitimate block.
+ * The live set holding the block is stored in *set, locked, and the slot of
+ * the block in it in *slot.  *set is NULL if the block is not live.
+ * Return NULL if cautious mode finds the block is not allocated.
  */
-static block_element_t *find_header(void *p)
+static block_element_t *find_header(void *p, live_set_t **set, size_t *slot)
 {
     if (!p) {
         report_event(MSG_ERROR, "Attempting to free null block");
@@ -79,23 +405,20 @@ static block_element_t *find_header(void *p)
 
     block_element_t *b =
         (block_element_t *) ((size_t) p - sizeof(block_element_t));
+    *set = live_locate(b, slot);
     if (cautious_mode) {
         /* Make sure this is really an allocated block */
-        block_element_t *ab = allocated;
-        bool found = false;
-        while (ab && !found) {
-            found = ab == b;
-            ab = ab->next;
-        }
-        if (!found) {
+        if (!*set) {
             report_event(MSG_ERROR,
                          "Attempted to free unallocated block.  Address = %p",
                          p);
             error_occurred = true;
+            /* Do not touch memory which may already be released */
+            return NULL;
         }
     }
 
-    if (b->magic_header != MAGICHEADER) {
+    if (b->magic_header != MAGICHEADER && b->magic_header != MAGICGUARD) {
         report_event(
             MSG_ERROR,
             "Attempted to free unallocated or corrupted block.  Address = %p",
@@ -115,9 +438,109 @@ static size_t *find_footer(block_element_t *b)
     return p;
 }
 
+/* The footer follows the payload directly, so it may be misaligned */
+static inline size_t get_footer(block_element_t *b)
+{
+    size_t footer;
+    memcpy(&footer, find_footer(b), sizeof(footer));
+    return footer;
+}
+
+static inline void set_footer(block_element_t *b, size_t footer)
+{
+    memcpy(find_footer(b), &footer, sizeof(footer));
+}
+
+static inline void fill_payload(void *p, size_t size)
+{
+    if (fill_limit < 0 || size <= (size_t) fill_limit)
+        memset(p, FILLCHAR, size);
+}
+
+/* Alignment of blocks in guard mode, which malloc() guarantees as well */
+#define GUARD_ALIGN _Alignof(max_align_t)
+
+/* Bytes from the payload of a block to the guard page, which leaves less than
+ * GUARD_ALIGN bytes of slack after the payload
+ */
+static inline size_t guard_span(size_t size)
+{
+    return (size + GUARD_ALIGN - 1) & ~(GUARD_ALIGN - 1);
+}
+
+/* Number of pages holding a block of the given size in guard mode */
+static size_t guard_pages(size_t size)
+{
+    return (guard_span(size) + sizeof(block_element_t) + page_size - 1) /
+           page_size;
+}
+
+/* Map a block whose payload ends at most GUARD_ALIGN - 1 bytes before a
+ * PROT_NONE page starts, so that writing past the payload faults at once.
+ * There is no footer.
+ */
+static block_element_t *guard_alloc(size_t size)
+{
+    pthread_mutex_lock(&quarantine_lock);
+    if (!page_size)
+        page_size = sysconf(_SC_PAGESIZE);
+
+    size_t pages = guard_pages(size);
+    char *base = NULL;
+
+    if (quarantine_count == QUARANTINE_SIZE) {
+        guard_map_t *old = &quarantine[quarantine_head];
+        quarantine_head = (quarantine_head + 1) % QUARANTINE_SIZE;
+        quarantine_count--;
+        if (old->pages == pages &&
+            !mprotect(old->base, pages * page_size, PROT_READ | PROT_WRITE))
+            base = old->base;
+        else
+            munmap(old->base, (old->pages + 1) * page_size);
+    }
+    pthread_mutex_unlock(&quarantine_lock);
+
+    if (!base) {
+        base = mmap(NULL, (pages + 1) * page_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+            return NULL;
+        if (mprotect(base + pages * page_size, page_size, PROT_NONE)) {
+            munmap(base, (pages + 1) * page_size);
+            return NULL;
+        }
+    }
+
+    return (block_element_t *) (base + pages * page_size - guard_span(size) -
+                                sizeof(block_element_t));
+}
+
+/* Make a block allocated by guard_alloc() inaccessible and quarantine it */
+static void guard_free(block_element_t *b)
+{
+    size_t pages = guard_pages(b->payload_size);
+    char *base = (char *) b + sizeof(block_element_t) +
+                 guard_span(b->payload_size) - pages * page_size;
+
+    mprotect(base, pages * page_size, PROT_NONE);
+
+    pthread_mutex_lock(&quarantine_lock);
+    if (quarantine_count == QUARANTINE_SIZE) {
+        guard_map_t *old = &quarantine[quarantine_head];
+        quarantine_head = (quarantine_head + 1) % QUARANTINE_SIZE;
+        quarantine_count--;
+        munmap(old->base, (old->pages + 1) * page_size);
+    }
+    guard_map_t *slot =
+        &quarantine[(quarantine_head + quarantine_count++) % QUARANTINE_SIZE];
+    slot->base = base;
+    slot->pages = pages;
+    pthread_mutex_unlock(&quarantine_lock);
+}
+
 /* Implementation of application functions */
 
-void *test_malloc(size_t size)
+void *test_malloc_at(size_t size, const char *file, int line)
 {
     if (noallocate_mode) {
         report_event(MSG_FATAL, "Calls to malloc disallowed");
@@ -130,44 +553,64 @@ void *test_malloc(size_t size)
     }
 
     block_element_t *new_block =
-        malloc(size + sizeof(block_element_t) + sizeof(size_t));
+        guard_mode ? guard_alloc(size)
+                   : malloc(size + sizeof(block_element_t) + sizeof(size_t));
     if (!new_block) {
         report_event(MSG_FATAL, "Couldn't allocate any more memory");
         error_occurred = true;
     }
 
     // cppcheck-suppress nullPointerRedundantCheck
-    new_block->magic_header = MAGICHEADER;
+    new_block->magic_header = guard_mode ? MAGICGUARD : MAGICHEADER;
     // cppcheck-suppress nullPointerRedundantCheck
     new_block->payload_size = size;
-    *find_footer(new_block) = MAGICFOOTER;
+    if (!guard_mode)
+        set_footer(new_block, MAGICFOOTER);
     void *p = (void *) &new_block->payload;
-    memset(p, FILLCHAR, size);
-    // cppcheck-suppress nullPointerRedundantCheck
-    new_block->next = allocated;
-    // cppcheck-suppress nullPointerRedundantCheck
-    new_block->prev = NULL;
+    fill_payload(p, size);
 
-    if (allocated)
-        allocated->prev = new_block;
-    allocated = new_block;
+    live_set_t *set = my_set();
+    pthread_mutex_lock(&set->lock);
+    live_insert(set, new_block);
+    pthread_mutex_unlock(&set->lock);
     allocated_count++;
 
+    alloc_site_t *site = &sites[new_block->site = site_find(file, line)];
+    new_block->birth = alloc_clock++;
+    site->allocs++;
+    site->bytes += size;
+    site->live++;
+    atomic_max(&site->peak_bytes, site->live_bytes += size);
+
     return p;
 }
 
-// cppcheck-suppress unusedFunction
-void *test_calloc(size_t nelem, size_t elsize)
+void *test_malloc(size_t size)
+{
+    return test_malloc_at(size, NULL, 0);
+}
+
+void *test_calloc_at(size_t nelem,
+                     size_t elsize,
+                     const char *file,
+                     int line)
 {
     /* Reference: Malloc tutorial
      * https://danluu.com/malloc-tutorial/
      */
     size_t size = nelem * elsize;  // TODO: check for overflow
-    void *ptr = test_malloc(size);
-    memset(ptr, 0, size);
+    void *ptr = test_malloc_at(size, file, line);
+    if (ptr)
+        memset(ptr, 0, size);
     return ptr;
 }
 
+// cppcheck-suppress unusedFunction
+void *test_calloc(size_t nelem, size_t elsize)
+{
+    return test_calloc_at(nelem, elsize, NULL, 0);
+}
+
 void test_free(void *p)
 {
     if (noallocate_mode) {
@@ -178,49 +621,176 @@ void test_free(void *p)
     if (!p)
         return;
 
-    block_element_t *b = find_header(p);
-    size_t footer = *find_footer(b);
-    if (footer != MAGICFOOTER) {
+    live_set_t *set;
+    size_t slot;
+    block_element_t *b = find_header(p, &set, &slot);
+    if (!b)
+        return;
+    bool guarded = b->magic_header == MAGICGUARD;
+    if (!guarded && get_footer(b) != MAGICFOOTER) {
         report_event(MSG_ERROR,
                      "Corruption detected in block with address %p when "
                      "attempting to free it",
                      p);
         error_occurred = true;
     }
+    if (b->site < SITE_MAX) {
+        alloc_site_t *site = &sites[b->site];
+        site->frees++;
+        site->live--;
+        site->live_bytes -= b->payload_size;
+        site->lifetime += alloc_clock - b->birth;
+    }
+
     b->magic_header = MAGICFREE;
-    *find_footer(b) = MAGICFREE;
-    memset(p, FILLCHAR, b->payload_size);
-
-    /* Unlink from list */
-    block_element_t *bn = b->next;
-    block_element_t *bp = b->prev;
-    if (bp)
-        bp->next = bn;
-    else
-        allocated = bn;
-    if (bn)
-        bn->prev = bp;
 
-    free(b);
+    if (set) {
+        live_remove(set, slot);
+        pthread_mutex_unlock(&set->lock);
+    }
+
+    if (guarded) {
+        guard_free(b);
+    } else {
+        set_footer(b, MAGICFREE);
+        fill_payload(p, b->payload_size);
+        free(b);
+    }
     allocated_count--;
 }
 
-// cppcheck-suppress unusedFunction
-char *test_strdup(const char *s)
+bool test_slab_alloc(size_t cnt)
+{
+    if (noallocate_mode) {
+        report_event(MSG_FATAL, "Calls to malloc disallowed");
+        return false;
+    }
+
+    if (fail_allocation()) {
+        report_event(MSG_WARN, "Malloc returning NULL");
+        return false;
+    }
+
+    allocated_count += cnt;
+    return true;
+}
+
+void test_slab_free(size_t cnt)
+{
+    if (!cnt)
+        return;
+
+    if (noallocate_mode) {
+        report_event(MSG_FATAL, "Calls to free disallowed");
+        return;
+    }
+
+    size_t count = allocated_count;
+    do {
+        if (cnt > count) {
+            report_event(MSG_ERROR,
+                         "Released more objects than were allocated");
+            error_occurred = true;
+            cnt = count;
+        }
+    } while (!atomic_compare_exchange_weak(&allocated_count, &count,
+                                           count - cnt));
+}
+
+void test_slab_error(const char *msg, const void *p)
+{
+    report_event(MSG_ERROR, "%s.  Address = %p", msg, p);
+    error_occurred = true;
+}
+
+char *test_strdup_at(const char *s, const char *file, int line)
 {
     size_t len = strlen(s) + 1;
-    void *new = test_malloc(len);
+    void *new = test_malloc_at(len, file, line);
     if (!new)
         return NULL;
 
     return memcpy(new, s, len);
 }
 
+// cppcheck-suppress unusedFunction
+char *test_strdup(const char *s)
+{
+    return test_strdup_at(s, NULL, 0);
+}
+
 size_t allocation_check()
 {
     return allocated_count;
 }
 
+void fault_update(int oldval)
+{
+    (void) oldval;
+
+    int percent = fail_probability < 0    ? 0
+                  : fail_probability > 100 ? 100
+                                           : fail_probability;
+    fault_threshold = ((uint64_t) percent << 32) / 100;
+
+    uint64_t seed = fail_seed ? (uint64_t) fail_seed : (uint64_t) random();
+    fault_state = (seed * 0x9e3779b97f4a7c15ULL) | 1;
+    fault_clock = 0;
+
+    fault_enabled = fault_threshold || fail_every > 0 || fail_nth > 0;
+}
+
+/* Order call sites by decreasing number of bytes allocated */
+static int site_cmp(const void *a, const void *b)
+{
+    const alloc_site_t *x = *(const alloc_site_t **) a;
+    const alloc_site_t *y = *(const alloc_site_t **) b;
+
+    if (x->bytes != y->bytes)
+        return x->bytes < y->bytes ? 1 : -1;
+    return x->allocs < y->allocs ? 1 : x->allocs > y->allocs ? -1 : 0;
+}
+
+void alloc_site_report()
+{
+    alloc_site_t *order[SITE_MAX];
+    size_t n = 0;
+
+    for (size_t i = 0; i < site_count; i++) {
+        if (sites[i].allocs || sites[i].frees || sites[i].live)
+            order[n++] = &sites[i];
+    }
+    qsort(order, n, sizeof(order[0]), site_cmp);
+
+    report(1, "%-24s %10s %10s %10s %12s %12s %12s %10s", "Call site",
+           "Allocs", "Frees", "Live", "Bytes", "Live bytes", "Peak bytes",
+           "Avg life");
+    for (size_t i = 0; i < n; i++) {
+        const alloc_site_t *site = order[i];
+        char where[64];
+
+        if (site->line)
+            snprintf(where, sizeof(where), "%s:%d", site->file, site->line);
+        else
+            snprintf(where, sizeof(where), "%s", site->file);
+        report(1, "%-24s %10zu %10zu %10zu %12zu %12zu %12zu %10.1f", where,
+               site->allocs, site->frees, site->live, site->bytes,
+               site->live_bytes, site->peak_bytes,
+               site->frees ? (double) site->lifetime / site->frees : 0.0);
+    }
+}
+
+void alloc_site_reset()
+{
+    for (size_t i = 0; i < site_count; i++) {
+        alloc_site_t *site = &sites[i];
+
+        site->allocs = site->frees = site->bytes = 0;
+        site->lifetime = 0;
+        site->peak_bytes = site->live_bytes;
+    }
+}
+
 /* Implementation of functions for testing */
 
 /* Set/unset cautious mode.
@@ -242,9 +812,7 @@ void set_noallocate_mode(bool noallocate)
 /* Return whether any errors have occurred since last time set error limit */
 bool error_check()
 {
-    bool e = error_occurred;
-    error_occurred = false;
-    return e;
+    return atomic_exchange(&error_occurred, false);
 }
 
 /* Prepare for a risky operation using setjmp.
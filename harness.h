@@ -8,6 +8,11 @@
 /* This test harness enables us to do stringent testing of code.
  * It overloads the library versions of malloc and free with ones that
  * allow checking for common allocation errors.
+ *
+ * The functions may be called from several threads at once.  Blocks may be
+ * freed by another thread than the one which allocated them, and each thread
+ * has its own exception context.  The modes and params are meant to be set
+ * while no other thread is running.
  */
 
 void *test_malloc(size_t size);
@@ -16,14 +21,71 @@ void test_free(void *p);
 char *test_strdup(const char *s);
 /* FIXME: provide test_realloc as well */
 
+/* Same as above, recording the call site the block is allocated from */
+void *test_malloc_at(size_t size, const char *file, int line);
+void *test_calloc_at(size_t nmemb, size_t size, const char *file, int line);
+char *test_strdup_at(const char *s, const char *file, int line);
+
+/* Allocators which carve objects out of blocks obtained from test_malloc
+ * report every object through these, so that the objects are subject to the
+ * same fault injection and leak accounting as individual blocks.
+ * test_slab_alloc() accounts for cnt objects allocated at once, and returns
+ * false when the allocation should fail.
+ * test_slab_free() accounts for cnt objects released at once.
+ */
+bool test_slab_alloc(size_t cnt);
+void test_slab_free(size_t cnt);
+
+/* Allocators report an object which is released twice, or written after it
+ * was released, through test_slab_error(), which flags an error like
+ * test_free() does for such a block.
+ */
+void test_slab_error(const char *msg, const void *p);
+
 #ifdef INTERNAL
 
 /* Report number of allocated blocks */
 size_t allocation_check();
 
+/* Print the allocation statistics of every call site of test_malloc(), by
+ * decreasing number of bytes allocated.  The lifetime of a block is measured
+ * in blocks allocated while it was live.
+ */
+void alloc_site_report();
+
+/* Restart the statistics of call sites, except for the live blocks */
+void alloc_site_reset();
+
+/* Whether new blocks end right before an inaccessible page, so that writing
+ * past them faults at once.  Blocks stay aligned like malloc() aligns them,
+ * so a block whose size is not a multiple of alignof(max_align_t) is followed
+ * by less than alignof(max_align_t) bytes of slack, where an overrun goes
+ * unnoticed.  Freed blocks stay inaccessible for a while.  Each block costs
+ * at least two pages, and a few system calls.
+ */
+extern int guard_mode;
+
+/* Largest payload filled with a pattern on malloc and free, -1 for all */
+extern int fill_limit;
+
 /* Probability of malloc failing, expressed as percent */
 extern int fail_probability;
 
+/* Fail every fail_every-th allocation, and allocation number fail_nth, both
+ * counted from the last call to fault_update().  0 disables the schedule.
+ */
+extern int fail_every;
+extern int fail_nth;
+
+/* Seed of the random failures, 0 to draw one from random() */
+extern int fail_seed;
+
+/* Apply the values of the fault injection variables above, and restart the
+ * schedules.  Must be called after changing any of them, which makes it the
+ * setter of their console params.
+ */
+void fault_update(int oldval);
+
 /*
  * Set/unset cautious mode.
  * In this mode, makes extra sure any block to be freed is currently allocated.
@@ -39,8 +101,10 @@ void set_noallocate_mode(bool noallocate);
 /* Return whether any errors have occurred since last time checked */
 bool error_check();
 
-/* Prepare for a risky operation using setjmp.
- * Function returns true for initial return, false for error return
+/* Prepare for a risky operation using setjmp, in the calling thread.
+ * Function returns true for initial return, false for error return.
+ * The time limit relies on SIGALRM, which threads other than the one setting
+ * the limit should block.
  */
 bool exception_setup(bool limit_time);
 
@@ -53,13 +117,15 @@ void trigger_exception(char *msg);
 
 #else /* !INTERNAL */
 
-/* Tested program use our versions of malloc and free */
-#define malloc test_malloc
+/* Tested program use our versions of malloc and free, which record where
+ * each block is allocated
+ */
+#define malloc(size) test_malloc_at(size, __FILE__, __LINE__)
 #define free test_free
 
 /* Use undef to avoid strdup redefined error */
 #undef strdup
-#define strdup test_strdup
+#define strdup(s) test_strdup_at(s, __FILE__, __LINE__)
 
 #endif
 
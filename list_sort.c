@@ -142,14 +142,263 @@ __attribute__((nonnull(1, 2))) void list_sort(struct list_head *head,
     merge_final(cmp, head, pending, list, descend);
 }
 
+/* Natural runs shorter than this are extended by insertion sort */
+#define MIN_RUN 32
+
+/* Consecutive wins of one run after which merging starts galloping */
+#define MIN_GALLOP 7
+
+/* Upper bound of pending runs, given the invariants kept by merge_collapse */
+#define MAX_PENDING 128
+
+/* A sorted, null-terminated run linked through the next pointers */
+struct run {
+    struct list_head *head, *tail;
+    size_t len;
+};
+
+/* Count the leading nodes of the n-node list x which come before key, i.e.
+ * compare less than key, or less than or equal to key unless strict is set.
+ * The count is found by exponential probing followed by a binary search, so
+ * it takes O(log count) comparisons.  The last counted node is stored in
+ * *last.
+ */
+__attribute__((nonnull(1, 2, 4, 7))) static size_t gallop(
+    list_cmp_func_t cmp,
+    struct list_head *x,
+    size_t n,
+    struct list_head *key,
+    bool strict,
+    bool descend,
+    struct list_head **last)
+{
+    /* The first lo nodes come before key; node hi does not (or hi == n) */
+    size_t lo = 0, hi = n, step = 1;
+    struct list_head *lo_node = x;
+    bool growing = true;
+
+    *last = NULL;
+    while (lo < hi) {
+        size_t i = growing ? step : (hi - lo + 1) / 2;
+        if (i > hi - lo)
+            i = hi - lo;
+
+        struct list_head *p = lo_node;
+        for (size_t j = 1; j < i; j++)
+            p = p->next;
+
+        int r = cmp(p, key, descend);
+        if (strict ? r < 0 : r <= 0) {
+            lo += i;
+            *last = p;
+            lo_node = p->next;
+            step *= 2;
+        } else {
+            hi = lo + i - 1;
+            growing = false;
+        }
+    }
+
+    return lo;
+}
+
+/* Stable merge of two adjacent runs, a holding the earlier elements */
+__attribute__((nonnull(1))) static struct run merge_gallop(
+    list_cmp_func_t cmp,
+    struct run a,
+    struct run b,
+    bool descend)
+{
+    struct run r = {.len = a.len + b.len};
+
+    /* Runs already in order are simply concatenated */
+    if (cmp(a.tail, b.head, descend) <= 0) {
+        a.tail->next = b.head;
+        r.head = a.head;
+        r.tail = b.tail;
+        return r;
+    }
+
+    struct list_head *head = NULL, **tail = &head, *last;
+    struct list_head *x = a.head, *y = b.head;
+    size_t nx = a.len, ny = b.len;
+    int wins_x = 0, wins_y = 0;
+
+    while (nx && ny) {
+        if (cmp(x, y, descend) <= 0) {
+            *tail = x;
+            tail = &x->next;
+            x = x->next;
+            nx--;
+            wins_y = 0;
+            if (++wins_x < MIN_GALLOP || !nx)
+                continue;
+
+            /* Take every node of a up to the head of b in one go */
+            size_t k = gallop(cmp, x, nx, y, false, descend, &last);
+            if (k) {
+                *tail = x;
+                tail = &last->next;
+                x = last->next;
+                nx -= k;
+            }
+            wins_x = 0;
+        } else {
+            /* if equal, take 'a' -- important for sort stability */
+            *tail = y;
+            tail = &y->next;
+            y = y->next;
+            ny--;
+            wins_x = 0;
+            if (++wins_y < MIN_GALLOP || !ny)
+                continue;
+
+            size_t k = gallop(cmp, y, ny, x, true, descend, &last);
+            if (k) {
+                *tail = y;
+                tail = &last->next;
+                y = last->next;
+                ny -= k;
+            }
+            wins_y = 0;
+        }
+    }
+
+    *tail = nx ? x : y;
+    r.head = head;
+    r.tail = nx ? a.tail : b.tail;
+    return r;
+}
+
+/* Cut the next natural run off the front of *list.  Strictly descending runs
+ * are reversed in place, and short runs are extended to MIN_RUN nodes by
+ * stable insertion.
+ */
+__attribute__((nonnull(1, 2))) static struct run next_run(
+    list_cmp_func_t cmp,
+    struct list_head **list,
+    bool descend)
+{
+    struct list_head *node = (*list)->next;
+    struct run r = {.head = *list, .tail = *list, .len = 1};
+
+    if (node && cmp(r.head, node, descend) > 0) {
+        struct list_head *prev = r.head;
+        r.head->next = NULL;
+        while (node && cmp(prev, node, descend) > 0) {
+            struct list_head *next = node->next;
+            node->next = r.head;
+            r.head = node;
+            r.len++;
+            prev = node;
+            node = next;
+        }
+    } else {
+        while (node && cmp(r.tail, node, descend) <= 0) {
+            r.tail = node;
+            node = node->next;
+            r.len++;
+        }
+        r.tail->next = NULL;
+    }
+
+    while (node && r.len < MIN_RUN) {
+        struct list_head *next = node->next;
+
+        if (cmp(r.tail, node, descend) <= 0) {
+            r.tail->next = node;
+            r.tail = node;
+            node->next = NULL;
+        } else {
+            /* Insert after the last node not greater than it */
+            struct list_head **pos = &r.head;
+            while (cmp(*pos, node, descend) <= 0)
+                pos = &(*pos)->next;
+            node->next = *pos;
+            *pos = node;
+        }
+        r.len++;
+        node = next;
+    }
+
+    *list = node;
+    return r;
+}
+
+/* Merge pending runs until their lengths decrease faster than the Fibonacci
+ * numbers from the bottom of the stack, which keeps merges balanced and the
+ * stack shallow.
+ */
+__attribute__((nonnull(1, 2, 3))) static void merge_collapse(
+    list_cmp_func_t cmp,
+    struct run *pending,
+    size_t *n,
+    bool descend)
+{
+    while (*n > 1) {
+        size_t m = *n - 2;
+
+        if ((m > 0 &&
+             pending[m - 1].len <= pending[m].len + pending[m + 1].len) ||
+            (m > 1 &&
+             pending[m - 2].len <= pending[m - 1].len + pending[m].len)) {
+            if (pending[m - 1].len < pending[m + 1].len)
+                m--;
+        } else if (pending[m].len > pending[m + 1].len) {
+            break;
+        }
+
+        pending[m] = merge_gallop(cmp, pending[m], pending[m + 1], descend);
+        for (size_t i = m + 1; i < *n - 1; i++)
+            pending[i] = pending[i + 1];
+        (*n)--;
+    }
+}
+
+__attribute__((nonnull(1, 2))) void list_timsort(struct list_head *head,
+                                                 list_cmp_func_t cmp,
+                                                 bool descend)
+{
+    struct list_head *list = head->next;
+    struct run pending[MAX_PENDING];
+    size_t n = 0;
+
+    if (list == head->prev) /* Zero or one elements */
+        return;
+
+    /* Convert to a null-terminated singly-linked list. */
+    head->prev->next = NULL;
+
+    while (list) {
+        pending[n++] = next_run(cmp, &list, descend);
+        merge_collapse(cmp, pending, &n, descend);
+    }
+
+    /* End of input; merge together all the pending runs. */
+    while (n > 1) {
+        pending[n - 2] =
+            merge_gallop(cmp, pending[n - 2], pending[n - 1], descend);
+        n--;
+    }
+
+    /* Rebuild prev links and make the list circular again */
+    struct list_head *prev = head;
+    for (list = pending[0].head; list; list = list->next) {
+        list->prev = prev;
+        prev->next = list;
+        prev = list;
+    }
+    prev->next = head;
+    head->prev = prev;
+}
+
 int cmp(const struct list_head *a, const struct list_head *b, bool descend)
 {
     element_t *a_entry = list_entry(a, element_t, list);
     element_t *b_entry = list_entry(b, element_t, list);
+    int r = q_compare(a_entry, b_entry);
 
-    if (!descend)
-        return strcmp(a_entry->value, b_entry->value) < 0 ? 0 : 1;
-    else
-        return strcmp(a_entry->value, b_entry->value) > 0 ? 0 : 1;
+    /* Equal values compare as 0 so that merges can keep them stable */
+    return descend ? -r : r;
 }
 // EXPORT_SYMBOL(list_sort);
@@ -14,6 +14,15 @@ __attribute__((nonnull(1, 2))) void list_sort(struct list_head *head,
                                               list_cmp_func_t cmp,
                                               bool descend);
 
+/* Adaptive, stable merge sort in the spirit of TimSort.  Natural ascending
+ * and strictly descending runs of the input are detected, the latter reversed
+ * in place, and runs are merged with galloping, so presorted input is sorted
+ * in close to linear time.
+ */
+__attribute__((nonnull(1, 2))) void list_timsort(struct list_head *head,
+                                                 list_cmp_func_t cmp,
+                                                 bool descend);
+
 __attribute__((nonnull(1, 2))) int cmp(const struct list_head *a,
                                        const struct list_head *b,
                                        bool descend);
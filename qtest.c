@@ -4,6 +4,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <signal.h>
 #include <spawn.h>
 #include <stdio.h>
@@ -60,7 +61,6 @@ extern int show_entropy;
 
 /* How large is a queue before it's considered big.
  * This affects how it gets printed
- * and whether cautious mode is used when freeing the queue
  */
 #define BIG_LIST_SIZE 30
 
@@ -85,12 +85,27 @@ static int descend = 0;
 
 #define MIN_RANDSTR_LEN 5
 #define MAX_RANDSTR_LEN 10
+
+/* Tail insertions repeated at least this many times go through
+ * q_insert_tail_batch(), with random strings generated RAND_BATCH at a time.
+ */
+#define BATCH_INSERT_MIN 1024
+#define RAND_BATCH 256
+
+/* Size of the packed buffer 'rhn' and 'rtn' copy removed strings into */
+#define PACKED_BUFSIZE 65536
 static const char charset[] = "abcdefghijklmnopqrstuvwxyz";
 /* For queue_insert and queue_remove */
 typedef enum {
     POS_TAIL,
     POS_HEAD,
 } position_t;
+/* For queue_sort */
+typedef enum {
+    SORTER_QUEUE, /* q_sort */
+    SORTER_LIST,  /* list_sort */
+    SORTER_TIM,   /* list_timsort */
+} sorter_t;
 /* Forward declarations */
 static bool q_show(int vlevel);
 
@@ -266,9 +281,6 @@ static bool do_free(int argc, char *argv[])
     }
     error_check();
 
-    if (current && current->size > BIG_LIST_SIZE)
-        set_cautious_mode(false);
-
     struct list_head *qnext = NULL;
     if (chain.size > 1) {
         qnext = (current->chain.next == &chain.head) ? chain.head.next
@@ -281,7 +293,6 @@ static bool do_free(int argc, char *argv[])
         if (exception_setup(true))
             q_free(current->q);
         exception_cancel();
-        set_cautious_mode(true);
     }
 
     if (current) {
@@ -344,6 +355,75 @@ static void fill_rand_string(char *buf, size_t buf_size)
 }
 
 /* insertion */
+/* Count a failed insertion, which is an error once there are too many */
+static bool insert_failed(char *inserts)
+{
+    fail_count++;
+    if (fail_count < fail_limit) {
+        report(2, "Insertion of %s failed", inserts);
+        return true;
+    }
+    report(1, "ERROR: Insertion of %s failed (%d failures total)", inserts,
+           fail_count);
+    return false;
+}
+
+/* Insert reps copies of inserts, or reps random strings, at the tail of the
+ * current queue through q_insert_tail_batch().  The number of elements
+ * inserted is added to *count.
+ */
+static bool insert_tail_batch(char *inserts,
+                              bool need_rand,
+                              int reps,
+                              int *count)
+{
+    char randstr[RAND_BATCH][MAX_RANDSTR_LEN];
+    char *sv[RAND_BATCH] = {inserts};
+    bool ok = true;
+
+    for (int done = 0; ok && done < reps;) {
+        int n = 1, r = reps - done;
+        if (need_rand) {
+            n = r < RAND_BATCH ? r : RAND_BATCH;
+            r = 1;
+            for (int i = 0; i < n; i++) {
+                fill_rand_string(randstr[i], sizeof(randstr[i]));
+                sv[i] = randstr[i];
+            }
+        }
+        done += n * r;
+
+        struct list_head *last = current->q->prev;
+        if (!q_insert_tail_batch(current->q, sv, n, r)) {
+            ok = insert_failed(need_rand ? "RAND" : inserts);
+            continue;
+        }
+        current->size += n * r;
+        *count += n * r;
+
+        element_t *first = list_entry(last->next, element_t, list);
+        if (!first->value) {
+            report(1, "ERROR: Failed to save copy of string in queue");
+            ok = false;
+        } else if (first->value == sv[0]) {
+            report(1,
+                   "ERROR: Need to allocate and copy string for new queue "
+                   "element");
+            ok = false;
+        } else if (n * r > 1 &&
+                   list_entry(first->list.next, element_t, list)->value ==
+                       first->value) {
+            report(1,
+                   "ERROR: Need to allocate separate string for each queue "
+                   "element");
+            ok = false;
+        }
+        ok = ok && !error_check();
+    }
+
+    return ok;
+}
+
 static bool queue_insert(position_t pos, int argc, char *argv[])
 {
     if (simulation) {
@@ -364,7 +444,9 @@ static bool queue_insert(position_t pos, int argc, char *argv[])
 
     char *lasts = NULL;
     char randstr_buf[MAX_RANDSTR_LEN];
-    int reps = 1;
+    int reps = 1, count = 0;
+    bool batch = false;
+    double timer;
     bool ok = true, need_rand = false;
     if (argc != 2 && argc != 3) {
         report(1, "%s needs 1-2 arguments", argv[0]);
@@ -389,7 +471,14 @@ static bool queue_insert(position_t pos, int argc, char *argv[])
                pos == POS_TAIL ? "tail" : "head");
     error_check();
 
+    init_time(&timer);
     if (current && exception_setup(true)) {
+        /* A null queue takes the path below, which reports the failures */
+        if (pos == POS_TAIL && reps >= BATCH_INSERT_MIN && current->q) {
+            batch = true;
+            ok = insert_tail_batch(argv[1], need_rand, reps, &count);
+            reps = 0;
+        }
         for (int r = 0; ok && r < reps; r++) {
             if (need_rand)
                 fill_rand_string(randstr_buf, sizeof(randstr_buf));
@@ -397,6 +486,7 @@ static bool queue_insert(position_t pos, int argc, char *argv[])
                                         : q_insert_head(current->q, inserts);
             if (rval) {
                 current->size++;
+                count++;
                 element_t *entry =
                     pos == POS_TAIL
                         ? list_last_entry(current->q, element_t, list)
@@ -420,21 +510,18 @@ static bool queue_insert(position_t pos, int argc, char *argv[])
                 }
                 lasts = cur_inserts;
             } else {
-                fail_count++;
-                if (fail_count < fail_limit)
-                    report(2, "Insertion of %s failed", inserts);
-                else {
-                    report(1,
-                           "ERROR: Insertion of %s failed (%d failures total)",
-                           inserts, fail_count);
-                    ok = false;
-                }
+                ok = insert_failed(inserts);
             }
             ok = ok && !error_check();
         }
     }
     exception_cancel();
 
+    if (count > 1)
+        report(2, "Inserted %d elements %s, %.1f ns per element", count,
+               batch ? "in batches" : "one by one",
+               delta_time(&timer) * 1e9 / count);
+
     q_show(3);
     return ok;
 }
@@ -451,6 +538,73 @@ static bool do_it(int argc, char *argv[])
     return queue_insert(POS_TAIL, argc, argv);
 }
 
+/* insert sorted */
+static bool do_is(int argc, char *argv[])
+{
+    char randstr_buf[MAX_RANDSTR_LEN];
+    int reps = 1, count = 0;
+    double timer;
+    bool ok = true;
+    if (argc != 2 && argc != 3) {
+        report(1, "%s needs 1-2 arguments", argv[0]);
+        return false;
+    }
+
+    char *inserts = argv[1];
+    if (argc == 3 && !get_int(argv[2], &reps)) {
+        report(1, "Invalid number of insertions '%s'", argv[2]);
+        return false;
+    }
+
+    bool need_rand = !strcmp(inserts, "RAND");
+    if (need_rand)
+        inserts = randstr_buf;
+
+    if (!current || !current->q) {
+        report(3, "Warning: Calling insert sorted on null queue");
+        return false;
+    }
+    error_check();
+
+    init_time(&timer);
+    if (exception_setup(true)) {
+        for (int r = 0; ok && r < reps; r++) {
+            if (need_rand)
+                fill_rand_string(randstr_buf, sizeof(randstr_buf));
+            if (q_insert_sorted(current->q, inserts, descend)) {
+                current->size++;
+                count++;
+            } else {
+                ok = insert_failed(inserts);
+            }
+            ok = ok && !error_check();
+        }
+    }
+    exception_cancel();
+
+    if (count > 1)
+        report(2, "Inserted %d elements in order, %.1f ns per element", count,
+               delta_time(&timer) * 1e9 / count);
+
+    /* The queue has to stay sorted */
+    struct list_head *cur_l;
+    list_for_each (cur_l, current->q) {
+        if (cur_l->next == current->q)
+            break;
+        int cmp = strcmp(list_entry(cur_l, element_t, list)->value,
+                         list_entry(cur_l->next, element_t, list)->value);
+        if (descend ? cmp < 0 : cmp > 0) {
+            report(1, "ERROR: Not sorted in %s order",
+                   descend ? "descending" : "ascending");
+            ok = false;
+            break;
+        }
+    }
+
+    q_show(3);
+    return ok;
+}
+
 static bool queue_remove(position_t pos, int argc, char *argv[])
 {
     /* FIXME: It is known that both functions is_remove_tail_const() and
@@ -580,10 +734,191 @@ static inline bool do_rt(int argc, char *argv[])
     return queue_remove(POS_TAIL, argc, argv);
 }
 
+static bool queue_remove_n(position_t pos, int argc, char *argv[])
+{
+    int n;
+    if (argc != 2) {
+        report(1, "%s needs 1 argument", argv[0]);
+        return false;
+    }
+    if (!get_int(argv[1], &n) || n < 0) {
+        report(1, "Invalid number of removals '%s'", argv[1]);
+        return false;
+    }
+
+    char *packed = malloc(PACKED_BUFSIZE + STRINGPAD);
+    if (!packed) {
+        report(1,
+               "INTERNAL ERROR.  Could not allocate space for removed strings");
+        return false;
+    }
+    memset(packed, 'X', PACKED_BUFSIZE + STRINGPAD);
+
+    if (!current || !current->size)
+        report(3, "Warning: Calling remove %s on empty queue",
+               pos == POS_TAIL ? "tail" : "head");
+    error_check();
+
+    LIST_HEAD(removed);
+    int cnt = -1;
+    if (current && exception_setup(true))
+        cnt = pos == POS_TAIL ? q_remove_tail_n(current->q, &removed, n, packed,
+                                                PACKED_BUFSIZE)
+                              : q_remove_head_n(current->q, &removed, n,
+                                                packed, PACKED_BUFSIZE);
+    exception_cancel();
+
+    bool ok = true;
+    int expected = current && current->size < n ? current->size : n;
+    if (cnt != expected) {
+        report(1, "ERROR: Removed %d elements, but expected %d", cnt,
+               expected);
+        ok = false;
+    }
+
+    /* Compare the packed strings against the removed elements */
+    int i = 0;
+    if (cnt > 0) {
+        struct list_head *node =
+            pos == POS_TAIL ? removed.prev : removed.next;
+        char *p = packed, *end = packed + PACKED_BUFSIZE;
+        for (; ok && i < cnt && p < end; i++) {
+            element_t *e = list_entry(node, element_t, list);
+            size_t len = strlen(p);
+            if (strncmp(p, e->value, len) ||
+                (p + len + 1 < end && e->value[len])) {
+                report(1, "ERROR: Packed value %s != removed value %s", p,
+                       e->value);
+                ok = false;
+            }
+            p += len + 1;
+            node = pos == POS_TAIL ? node->prev : node->next;
+        }
+        if (packed[PACKED_BUFSIZE] != 'X') {
+            report(1,
+                   "ERROR: copying of strings in remove_%s_n overflowed "
+                   "destination buffer.",
+                   pos == POS_TAIL ? "tail" : "head");
+            ok = false;
+        }
+        current->size -= cnt;
+    }
+    q_release_list(&removed);
+
+    if (ok)
+        report(2, "Removed %d elements from queue, %d of them packed", cnt, i);
+    q_show(3);
+
+    free(packed);
+    return ok && !error_check();
+}
+
+static inline bool do_rhn(int argc, char *argv[])
+{
+    return queue_remove_n(POS_HEAD, argc, argv);
+}
+
+static inline bool do_rtn(int argc, char *argv[])
+{
+    return queue_remove_n(POS_TAIL, argc, argv);
+}
+
+/* Copy of a string in the queue, which the unsorted dedup is checked with */
+typedef struct {
+    char *value;
+    int idx;
+} dedup_ref_t;
+
+static int dedup_ref_cmp(const void *a, const void *b)
+{
+    const dedup_ref_t *ra = a, *rb = b;
+    int r = strcmp(ra->value, rb->value);
+    return r ? r : ra->idx - rb->idx;
+}
+
+/* Check q_delete_dup_unsorted() against copies of the strings sorted with
+ * qsort(), which find the duplicates independently of the queue code.
+ */
+static bool do_dedup_unsorted(void)
+{
+    int n = current->size;
+    size_t total = 0;
+    element_t *item;
+
+    list_for_each_entry (item, current->q, list)
+        total += strlen(item->value) + 1;
+
+    char *values = malloc(total + 1);
+    dedup_ref_t *refs = malloc((n + 1) * sizeof(dedup_ref_t));
+    bool *dup = calloc(n + 1, sizeof(bool));
+    if (!values || !refs || !dup) {
+        free(values);
+        free(refs);
+        free(dup);
+        report(1,
+               "INTERNAL ERROR.  Could not allocate space for duplicate "
+               "checking");
+        return false;
+    }
+
+    char *p = values;
+    int i = 0;
+    list_for_each_entry (item, current->q, list) {
+        size_t slen = strlen(item->value) + 1;
+        refs[i].value = memcpy(p, item->value, slen);
+        refs[i].idx = i;
+        p += slen;
+        i++;
+    }
+
+    bool ok = true;
+    if (exception_setup(true))
+        ok = q_delete_dup_unsorted(current->q);
+    exception_cancel();
+
+    if (!ok) {
+        report(1, "ERROR: Calling delete duplicate on null queue");
+    } else {
+        qsort(refs, n, sizeof(dedup_ref_t), dedup_ref_cmp);
+        for (i = 0; i + 1 < n; i++) {
+            if (!strcmp(refs[i].value, refs[i + 1].value))
+                dup[refs[i].idx] = dup[refs[i + 1].idx] = true;
+        }
+
+        /* The distinct strings must remain in their original order */
+        struct list_head *l_tmp = current->q->next;
+        p = values;
+        for (i = 0; i < n; i++) {
+            if (dup[i]) {
+                current->size--;
+            } else if (l_tmp != current->q &&
+                       !strcmp(list_entry(l_tmp, element_t, list)->value, p)) {
+                l_tmp = l_tmp->next;
+            } else {
+                ok = false;
+            }
+            p += strlen(p) + 1;
+        }
+        ok = ok && l_tmp == current->q;
+        if (!ok)
+            report(1,
+                   "ERROR: Duplicate strings are in queue or distinct strings "
+                   "are not in queue in their original order");
+    }
+
+    free(values);
+    free(refs);
+    free(dup);
+
+    q_show(3);
+    return ok && !error_check();
+}
+
 static bool do_dedup(int argc, char *argv[])
 {
-    if (argc != 1) {
-        report(1, "%s takes no arguments", argv[0]);
+    bool unsorted = argc == 2 && !strcmp(argv[1], "-u");
+    if (argc != 1 && !unsorted) {
+        report(1, "%s takes no arguments other than -u", argv[0]);
         return false;
     }
 
@@ -592,6 +927,9 @@ static bool do_dedup(int argc, char *argv[])
         return false;
     }
 
+    if (unsorted)
+        return do_dedup_unsorted();
+
     LIST_HEAD(l_copy);
     element_t *item = NULL, *tmp = NULL;
 
@@ -696,6 +1034,134 @@ static bool do_reverse(int argc, char *argv[])
     return !error_check();
 }
 
+static bool do_memstat(int argc, char *argv[])
+{
+    bool reset = argc == 2 && !strcmp(argv[1], "reset");
+    if (argc != 1 && !reset) {
+        report(1, "%s takes no arguments other than reset", argv[0]);
+        return false;
+    }
+
+    if (reset)
+        alloc_site_reset();
+    else
+        alloc_site_report();
+    return true;
+}
+
+/* Work of one thread of the stress command */
+typedef struct {
+    pthread_t thread;
+    int id;
+    int n;
+    struct list_head *q; /* Left for the main thread to free, or NULL */
+    bool ok;
+} stress_job_t;
+
+static void *stress_worker(void *arg)
+{
+    stress_job_t *job = arg;
+    char buf[MAX_RANDSTR_LEN];
+    sigset_t mask;
+
+    /* The time limit of the command belongs to the main thread */
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    struct list_head *q = q_new();
+    if (!q)
+        return NULL;
+
+    if (exception_setup(false)) {
+        for (int i = 0; i < job->n; i++) {
+            fill_rand_string(buf, sizeof(buf));
+            if (!(i & 1 ? q_insert_tail(q, buf) : q_insert_head(q, buf)))
+                break;
+        }
+        q_sort(q, false);
+        q_delete_dup(q);
+        q_reverse(q);
+        for (int i = q_size(q) / 2; i > 0; i--)
+            q_release_element(q_remove_head(q, NULL, 0));
+        job->ok = true;
+    }
+    exception_cancel();
+
+    /* Every other queue is freed by the main thread, whose frees reach the
+     * blocks allocated by this thread after it exited.
+     */
+    if (job->ok && job->id % 2) {
+        job->q = q;
+        return NULL;
+    }
+    if (exception_setup(false))
+        q_free(q);
+    exception_cancel();
+    return NULL;
+}
+
+/* Run queue operations on several threads at once under the checks of the
+ * harness
+ */
+static bool do_stress(int argc, char *argv[])
+{
+    int nthreads = 4, n = 10000;
+
+    if (argc > 3 || (argc > 1 && !get_int(argv[1], &nthreads)) ||
+        (argc > 2 && !get_int(argv[2], &n)) || nthreads < 1 || n < 0) {
+        report(1, "%s takes a number of threads and of elements", argv[0]);
+        return false;
+    }
+
+    stress_job_t *jobs = calloc(nthreads, sizeof(stress_job_t));
+    if (!jobs) {
+        report(1, "ERROR: Could not allocate the threads");
+        return false;
+    }
+
+    size_t bcnt = allocation_check();
+    bool ok = true;
+    int started = 0;
+    error_check();
+
+    double timer;
+    init_time(&timer);
+    for (; started < nthreads; started++) {
+        jobs[started].id = started;
+        jobs[started].n = n;
+        if (pthread_create(&jobs[started].thread, NULL, stress_worker,
+                           &jobs[started]))
+            break;
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(jobs[i].thread, NULL);
+        ok = ok && jobs[i].ok;
+        if (jobs[i].q) {
+            if (exception_setup(true))
+                q_free(jobs[i].q);
+            exception_cancel();
+        }
+    }
+    free(jobs);
+
+    if (started < nthreads) {
+        report(1, "ERROR: Started only %d threads", started);
+        ok = false;
+    }
+    if (!ok)
+        report(1, "ERROR: Queue operations failed on some threads");
+    if (allocation_check() != bcnt) {
+        report(1, "ERROR: %ld blocks leaked by the threads",
+               (long) (allocation_check() - bcnt));
+        ok = false;
+    }
+    report(2, "Stressed %d threads with %d elements each in %.3f s", started,
+           n, delta_time(&timer));
+
+    return ok && !error_check();
+}
+
 static bool do_size(int argc, char *argv[])
 {
     if (argc != 1 && argc != 2) {
@@ -739,12 +1205,28 @@ static bool do_size(int argc, char *argv[])
         }
     }
 
+    /* q_size() only reports the length cached in the queue header, so walk
+     * the list once to make sure the cache has not drifted.
+     */
+    if (current && current->q && ok) {
+        int len = 0;
+        struct list_head *li;
+        list_for_each (li, current->q)
+            len++;
+        if (len != cnt) {
+            report(1,
+                   "ERROR: Cached queue size is %d, but %d elements are linked",
+                   cnt, len);
+            ok = false;
+        }
+    }
+
     q_show(3);
 
     return ok && !error_check();
 }
 
-bool do_sort(int argc, char *argv[])
+static bool queue_sort(sorter_t sorter, int argc, char *argv[])
 {
     if (argc != 1) {
         report(1, "%s takes no arguments", argv[0]);
@@ -762,12 +1244,34 @@ bool do_sort(int argc, char *argv[])
         report(3, "Warning: Calling sort on single node");
     error_check();
 
+    double timer;
+    init_time(&timer);
     set_noallocate_mode(true);
-    if (current && exception_setup(true))
-        q_sort(current->q, descend);
+    if (current && exception_setup(true)) {
+        switch (sorter) {
+        case SORTER_LIST:
+            list_sort(current->q, cmp, descend);
+            q_drop_index(current->q);
+            break;
+        case SORTER_TIM:
+            list_timsort(current->q, cmp, descend);
+            q_drop_index(current->q);
+            break;
+        default:
+            q_sort(current->q, descend);
+            break;
+        }
+    }
     exception_cancel();
     set_noallocate_mode(false);
 
+    if (cnt > 1)
+        report(2, "Sorted %d elements with %s in %.3f s", cnt,
+               sorter == SORTER_LIST  ? "list_sort"
+               : sorter == SORTER_TIM ? "list_timsort"
+                                      : "q_sort",
+               delta_time(&timer));
+
     bool ok = true;
     if (current && current->size) {
         for (struct list_head *cur_l = current->q->next;
@@ -794,60 +1298,27 @@ bool do_sort(int argc, char *argv[])
     return ok && !error_check();
 }
 
-bool do_lsort(int argc, char *argv[])
+bool do_sort(int argc, char *argv[])
 {
-    if (argc != 1) {
-        report(1, "%s takes no arguments", argv[0]);
-        return false;
-    }
-
-    int cnt = 0;
-    if (!current || !current->q)
-        report(3, "Warning: Calling sort on null queue");
-    else
-        cnt = q_size(current->q);
-    error_check();
-
-    if (cnt < 2)
-        report(3, "Warning: Calling sort on single node");
-    error_check();
-
-    set_noallocate_mode(true);
-    if (current && exception_setup(true))
-        list_sort(current->q, cmp, descend);
-    exception_cancel();
-    set_noallocate_mode(false);
-
-    bool ok = true;
-    if (current && current->size) {
-        for (struct list_head *cur_l = current->q->next;
-             cur_l != current->q && --cnt; cur_l = cur_l->next) {
-            /* Ensure each element in ascending/descending order */
-            element_t *item, *next_item;
-            item = list_entry(cur_l, element_t, list);
-            next_item = list_entry(cur_l->next, element_t, list);
-            if (!descend && strcmp(item->value, next_item->value) > 0) {
-                report(1, "ERROR: Not sorted in ascending order");
-                ok = false;
-                break;
-            }
+    return queue_sort(SORTER_QUEUE, argc, argv);
+}
 
-            if (descend && strcmp(item->value, next_item->value) < 0) {
-                report(1, "ERROR: Not sorted in descending order");
-                ok = false;
-                break;
-            }
-        }
-    }
+bool do_lsort(int argc, char *argv[])
+{
+    return queue_sort(SORTER_LIST, argc, argv);
+}
 
-    q_show(3);
-    return ok && !error_check();
+bool do_tsort(int argc, char *argv[])
+{
+    return queue_sort(SORTER_TIM, argc, argv);
 }
 
 static bool do_shuffle(int argc, char *argv[])
 {
-    if (argc != 1) {
-        report(1, "%s takes no arguments", argv[0]);
+    bool walk = argc == 2 && !strcmp(argv[1], "walk");
+    bool merge = argc == 2 && !strcmp(argv[1], "merge");
+    if (argc != 1 && !walk && !merge) {
+        report(1, "%s takes no arguments other than walk or merge", argv[0]);
         return false;
     }
 
@@ -857,8 +1328,15 @@ static bool do_shuffle(int argc, char *argv[])
     if (q_size(current->q) < 2)
         report(3, "Warning: Calling shuffle on single queue");
     error_check();
-    if (exception_setup(true))
-        q_shuffle(current->q);
+    if (exception_setup(true)) {
+        if (walk)
+            q_shuffle(current->q);
+        else if (merge)
+            q_shuffle_merge(current->q);
+        else
+            q_shuffle_array(current->q);
+    }
+    exception_cancel();
     q_show(3);
     return !error_check();
 }
@@ -889,6 +1367,58 @@ static bool do_dm(int argc, char *argv[])
     return ok && !error_check();
 }
 
+static bool do_da(int argc, char *argv[])
+{
+    if (argc != 2) {
+        report(1, "%s takes 1 argument", argv[0]);
+        return false;
+    }
+
+    char *end;
+    errno = 0;
+    double ratio = strtod(argv[1], &end);
+    if (errno || end == argv[1] || *end || !(ratio >= 0 && ratio <= 1)) {
+        report(1, "Invalid ratio '%s', expected a number from 0 to 1",
+               argv[1]);
+        return false;
+    }
+
+    if (!current || !current->q) {
+        report(3, "Warning: Try to access null queue");
+        return false;
+    }
+    error_check();
+
+    /* Remember the node which should be deleted */
+    int size = current->size, idx = ratio * size;
+    if (idx >= size)
+        idx = size - 1;
+    struct list_head *expect = current->q->next;
+    for (int i = 0; i < idx; i++)
+        expect = expect->next;
+
+    bool ok = true;
+    if (exception_setup(true))
+        ok = q_delete_at(current->q, ratio);
+    exception_cancel();
+
+    if (!size) {
+        report(3, "Warning: Try to delete node of empty queue");
+    } else {
+        --current->size;
+        struct list_head *node;
+        list_for_each (node, current->q) {
+            if (ok && node == expect) {
+                report(1, "ERROR: Deleted a node other than the %d-th one",
+                       idx);
+                ok = false;
+            }
+        }
+    }
+    q_show(3);
+    return ok && !error_check();
+}
+
 static bool do_swap(int argc, char *argv[])
 {
     if (argc != 1) {
@@ -1058,7 +1588,7 @@ static bool do_merge(int argc, char *argv[])
     exception_cancel();
     set_noallocate_mode(false);
 
-    if (q_size(&chain.head) > 1) {
+    if (chain.size > 1) {
         chain.size = 1;
         current = list_entry(chain.head.next, queue_contex_t, chain);
         current->size = len;
@@ -1246,6 +1776,36 @@ static bool do_next(int argc, char *argv[])
     return q_show(0);
 }
 
+/* Setters of the params choosing an algorithm, which keep the old value when
+ * the new one names no algorithm.
+ */
+static void sort_mode_update(int oldval)
+{
+    if (sort_mode < SORT_TOP_DOWN || sort_mode > SORT_RADIX) {
+        report(1, "ERROR: Unknown sort algorithm %d", sort_mode);
+        sort_mode = oldval;
+    }
+}
+
+static void merge_mode_update(int oldval)
+{
+    if (merge_mode < MERGE_HEAP || merge_mode > MERGE_PAIRWISE) {
+        report(1, "ERROR: Unknown merge strategy %d", merge_mode);
+        merge_mode = oldval;
+    }
+}
+
+static void sort_threads_update(int oldval)
+{
+    (void) oldval;
+
+    if (sort_threads < 1 || sort_threads > PARALLEL_MAX_THREADS) {
+        int clamped = sort_threads < 1 ? 1 : PARALLEL_MAX_THREADS;
+        report(1, "Number of threads %d clamped to %d", sort_threads, clamped);
+        sort_threads = clamped;
+    }
+}
+
 static void console_init()
 {
     ADD_COMMAND(new, "Create new queue", "");
@@ -1260,6 +1820,11 @@ static void console_init()
                 "Insert string str at tail of queue n times. Generate random "
                 "string(s) if str equals RAND. (default: n == 1)",
                 "str [n]");
+    ADD_COMMAND(is,
+                "Insert string str at its place in sorted queue n times. "
+                "Generate random string(s) if str equals RAND. "
+                "(default: n == 1)",
+                "str [n]");
     ADD_COMMAND(
         rh,
         "Remove from head of queue. Optionally compare to expected value str",
@@ -1268,16 +1833,38 @@ static void console_init()
         rt,
         "Remove from tail of queue. Optionally compare to expected value str",
         "[str]");
+    ADD_COMMAND(rhn, "Remove n elements from head of queue at once", "n");
+    ADD_COMMAND(rtn, "Remove n elements from tail of queue at once", "n");
     ADD_COMMAND(reverse, "Reverse queue", "");
     ADD_COMMAND(sort, "Sort queue in ascending/descening order", "");
     ADD_COMMAND(
         lsort,
         "Sort queue in ascending/descening order provided by linux kernel", "");
-    ADD_COMMAND(shuffle, "Do the Fisher–Yates Shuffle algorithm", "");
+    ADD_COMMAND(tsort,
+                "Sort queue in ascending/descening order with adaptive "
+                "natural-run merge sort",
+                "");
+    ADD_COMMAND(shuffle,
+                "Do the Fisher–Yates Shuffle algorithm. With walk, reach "
+                "every node by walking the list instead of an array. With "
+                "merge, do a merge shuffle without extra memory",
+                "[walk|merge]");
     ADD_COMMAND(size, "Compute queue size n times (default: n == 1)", "[n]");
+    ADD_COMMAND(stress,
+                "Run queue operations on t threads with n elements each "
+                "(default: t == 4, n == 10000)",
+                "[t] [n]");
+    ADD_COMMAND(memstat,
+                "Show allocations per call site, or restart counting them",
+                "[reset]");
     ADD_COMMAND(show, "Show queue contents", "");
     ADD_COMMAND(dm, "Delete middle node in queue", "");
-    ADD_COMMAND(dedup, "Delete all nodes that have duplicate string", "");
+    ADD_COMMAND(da, "Delete node at position ratio * size in queue",
+                "ratio");
+    ADD_COMMAND(dedup,
+                "Delete all nodes that have duplicate string. With -u, the "
+                "queue need not be sorted",
+                "[-u]");
     ADD_COMMAND(merge, "Merge all the queues into one sorted queue", "");
     ADD_COMMAND(swap, "Swap every two adjacent nodes in queue", "");
     ADD_COMMAND(ascend,
@@ -1296,11 +1883,30 @@ static void console_init()
     add_param("length", &string_length, "Maximum length of displayed string",
               NULL);
     add_param("malloc", &fail_probability, "Malloc failure probability percent",
-              NULL);
+              fault_update);
+    add_param("malloc_every", &fail_every,
+              "Fail every n-th malloc from now on (0: never)", fault_update);
+    add_param("malloc_nth", &fail_nth,
+              "Fail the n-th malloc from now on (0: none)", fault_update);
+    add_param("malloc_seed", &fail_seed,
+              "Seed of random malloc failures (0: random seed)", fault_update);
+    add_param("guard", &guard_mode,
+              "Place each malloced block against a guard page", NULL);
+    add_param("fill", &fill_limit,
+              "Largest block filled with a pattern (-1: no limit)", NULL);
     add_param("fail", &fail_limit,
               "Number of times allow queue operations to return false", NULL);
     add_param("descend", &descend,
               "Sort and merge queue in ascending/descending order", NULL);
+    add_param("sort", &sort_mode,
+              "Algorithm of sort (0: top-down merge, 1: bottom-up merge, "
+              "2: parallel merge, 3: radix)",
+              sort_mode_update);
+    add_param("threads", &sort_threads, "Number of threads of parallel sort",
+              sort_threads_update);
+    add_param("merge", &merge_mode,
+              "Strategy of merge (0: k-way heap, 1: pairwise)",
+              merge_mode_update);
 }
 
 /* Signal handlers */
@@ -1333,8 +1939,6 @@ static void q_init()
 static bool q_quit(int argc, char *argv[])
 {
     report(3, "Freeing queue");
-    if (current && current->size > BIG_LIST_SIZE)
-        set_cautious_mode(false);
 
     if (exception_setup(true)) {
         struct list_head *cur = chain.head.next;
@@ -1348,7 +1952,6 @@ static bool q_quit(int argc, char *argv[])
     }
 
     exception_cancel();
-    set_cautious_mode(true);
 
     size_t bcnt = allocation_check();
     if (bcnt > 0) {
@@ -1362,8 +1965,9 @@ static bool q_quit(int argc, char *argv[])
 
 static void usage(char *cmd)
 {
-    printf("Usage: %s [-h] [-f IFILE][-v VLEVEL][-l LFILE]\n", cmd);
+    printf("Usage: %s [-h] [-s] [-f IFILE][-v VLEVEL][-l LFILE]\n", cmd);
     printf("\t-h         Print this information\n");
+    printf("\t-s         Keep queue elements in list order in memory\n");
     printf("\t-f IFILE   Read commands from IFILE\n");
     printf("\t-v VLEVEL  Set verbosity level\n");
     printf("\t-l LFILE   Echo results to LFILE\n");
@@ -1437,11 +2041,14 @@ int main(int argc, char *argv[])
     int level = 4;
     int c;
 
-    while ((c = getopt(argc, argv, "hv:f:l:")) != -1) {
+    while ((c = getopt(argc, argv, "hsv:f:l:")) != -1) {
         switch (c) {
         case 'h':
             usage(argv[0]);
             break;
+        case 's':
+            queue_layout = LAYOUT_SEGMENTED;
+            break;
         case 'f':
             strncpy(buf, optarg, BUFSIZE);
             buf[BUFSIZE - 1] = '\0';
@@ -1,7 +1,11 @@
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "hlist.h"
 #include "queue.h"
 
 /* Notice: sometimes, Cppcheck would find the potential NULL pointer bugs,
@@ -14,22 +18,283 @@
     for (node = (head)->prev, safe = node->prev; node != (head); \
          node = safe, safe = node->prev)
 
+/* Number of elements in the first slab chunk of a queue.  Each further chunk
+ * doubles in size until it reaches CHUNK_MAX elements.
+ */
+#define CHUNK_MIN 16
+#define CHUNK_MAX 4096
+
+/**
+ * struct q_chunk - Block of memory the elements of a queue are carved from
+ * @list: node in the chunk list of the owning queue
+ * @owner: queue which releases this chunk in q_free()
+ * @capacity: number of elements in @elems
+ * @used: number of elements in @elems handed out so far
+ * @pool_size: bytes of string storage following @elems
+ * @elems: storage of the elements
+ *
+ * Chunks made by q_insert_tail_batch() also hold the long values of the batch
+ * right after the elements, which are released together with the chunk.
+ */
+struct q_chunk {
+    struct list_head list;
+    queue_t *owner;
+    int capacity;
+    int used;
+    size_t pool_size;
+    element_t elems[];
+};
+
+static inline char *chunk_pool(const struct q_chunk *c)
+{
+    return (char *) &c->elems[c->capacity];
+}
+
+/* Whether the value of e was malloced on its own */
+static inline bool value_on_heap(const element_t *e)
+{
+    uintptr_t pool = (uintptr_t) chunk_pool(e->chunk);
+
+    return e->value != e->buf &&
+           (uintptr_t) e->value - pool >= e->chunk->pool_size;
+}
+
+/* Levels of the skip list of q_insert_sorted() above the list itself.  A node
+ * reaches each further level with probability 1/4, so this covers 4^16
+ * elements.
+ */
+#define INDEX_LEVELS 16
+
+/* Bytes of each block the nodes of the skip list are carved from */
+#define INDEX_BLOCK 16384
+
+/**
+ * struct index_node - Node of the skip list over a sorted queue
+ * @e: element this node stands for
+ * @next: next node on each level the node reaches, from level 1 up
+ */
+struct index_node {
+    element_t *e;
+    struct index_node *next[];
+};
+
+struct index_block {
+    struct index_block *next;
+    char mem[INDEX_BLOCK];
+};
+
+/**
+ * struct q_index - Skip list kept by q_insert_sorted()
+ * @valid: cleared by every other operation changing the queue
+ * @descend: order the skip list was built for
+ * @levels: number of levels in use above the list
+ * @heads: first node of each level
+ * @blocks: blocks the nodes are carved from
+ * @cur: block nodes are currently carved from, NULL before the first node
+ * @used: bytes of @cur handed out
+ *
+ * Level 0 of the skip list is the queue itself, so only the elements reaching
+ * level 1 or above get a node.  Nodes are never freed one by one: a dropped
+ * index is built again in the same blocks, which q_free() releases.
+ */
+struct q_index {
+    bool valid;
+    bool descend;
+    int levels;
+    struct index_node *heads[INDEX_LEVELS];
+    struct index_block *blocks, *cur;
+    size_t used;
+};
+
+static inline void index_invalidate(queue_t *q)
+{
+    if (q->index)
+        q->index->valid = false;
+}
+
+/* Key of released elements, whose value is NULL.  Both are checked when an
+ * element is released again or handed out again, to catch elements released
+ * twice or written after release.
+ */
+#define RELEASED_KEY 0xdeadbeefdeadbeefULL
+
+static inline void mark_released(element_t *e)
+{
+    e->value = NULL;
+    e->key = RELEASED_KEY;
+}
+
+static inline bool is_released(const element_t *e)
+{
+    return !e->value && e->key == RELEASED_KEY;
+}
+
 /*declaration*/
-element_t *new_node(char *s);
+element_t *new_node(queue_t *q, char *s);
+
+int sort_mode = SORT_TOP_DOWN;
+
+/* Keep the counters of the queue in sync with linked elements */
+static inline void account_insert(queue_t *q, const element_t *e)
+{
+    q->size++;
+    if (value_on_heap(e))
+        q->heap_values++;
+    index_invalidate(q);
+}
+
+static inline void account_remove(queue_t *q, const element_t *e)
+{
+    q->size--;
+    if (value_on_heap(e))
+        q->heap_values--;
+    index_invalidate(q);
+}
+
+/* Hand out an unused element from the slab of the queue */
+static element_t *slab_alloc(queue_t *q)
+{
+    element_t *e;
+
+    if (!list_empty(&q->free_elems)) {
+        e = list_first_entry(&q->free_elems, element_t, list);
+        list_del(&e->list);
+        if (!is_released(e))
+            test_slab_error("Element was written after being released", e);
+    } else {
+        struct q_chunk *c =
+            list_empty(&q->chunks)
+                ? NULL
+                : list_first_entry(&q->chunks, struct q_chunk, list);
+
+        if (!c || c->used == c->capacity) {
+            /* Batch chunks may be larger than CHUNK_MAX */
+            int capacity = c ? c->capacity : CHUNK_MIN / 2;
+            capacity = capacity < CHUNK_MAX / 2 ? capacity * 2 : CHUNK_MAX;
+
+            c = malloc(sizeof(struct q_chunk) + capacity * sizeof(element_t));
+            if (!c)
+                return NULL;
+            c->owner = q;
+            c->capacity = capacity;
+            c->used = 0;
+            c->pool_size = 0;
+            list_add(&c->list, &q->chunks);
+        }
+        e = &c->elems[c->used++];
+        e->chunk = c;
+    }
+
+    /* Each element is still subject to fault injection and leak checking */
+    if (!test_slab_alloc(1)) {
+        mark_released(e);
+        list_add(&e->list, &q->free_elems);
+        return NULL;
+    }
+
+    return e;
+}
+
+/* Hand the slab of src over to dst, which now holds the elements of src */
+static void slab_merge(queue_t *dst, queue_t *src)
+{
+    struct q_chunk *c;
+
+    list_for_each_entry (c, &src->chunks, list)
+        c->owner = dst;
+    list_splice_tail_init(&src->chunks, &dst->chunks);
+    list_splice_tail_init(&src->free_elems, &dst->free_elems);
+}
+
+int queue_layout = LAYOUT_LINKED;
+
+/* Let node take the place of old in its list */
+static inline void take_place(struct list_head *old, struct list_head *node)
+{
+    node->next = old->next;
+    node->next->prev = node;
+    node->prev = old->prev;
+    node->prev->next = node;
+}
+
+/* Exchange the contents of the slots a and b.  Each element stays at its
+ * position in the list it is on, which is either a queue or a free list.
+ */
+static void swap_slots(element_t *a, element_t *b)
+{
+    bool a_inline = a->value == a->buf, b_inline = b->value == b->buf;
+    struct list_head hole;
+    element_t tmp;
+
+    /* The hole holds the position of a while its slot is overwritten, which
+     * also covers a and b being neighbours.
+     */
+    take_place(&a->list, &hole);
+    tmp = *a;
+    *a = *b;
+    take_place(&b->list, &a->list);
+    *b = tmp;
+    take_place(&hole, &b->list);
+
+    if (b_inline)
+        a->value = a->buf;
+    if (a_inline)
+        b->value = b->buf;
+}
+
+/* Move the elements of the queue into the slots of its slab in list order */
+void q_compact(struct list_head *head)
+{
+    if (!head || list_empty(head))
+        return;
+
+    queue_t *q = queue_of(head);
+    struct list_head *node = head->next;
+    struct q_chunk *c;
+
+    index_invalidate(q);
+
+    /* The elements before node already fill the slots before the current one,
+     * so the element at node sits in the current slot or a later one.
+     */
+    list_for_each_entry (c, &q->chunks, list) {
+        for (int i = 0; i < c->used && node != head; i++) {
+            element_t *e = list_entry(node, element_t, list);
+            if (e != &c->elems[i])
+                swap_slots(&c->elems[i], e);
+            node = c->elems[i].list.next;
+        }
+        if (node == head)
+            break;
+    }
+}
+
+/* Called after the order of the queue changed */
+static inline void reordered(struct list_head *head)
+{
+    index_invalidate(queue_of(head));
+    if (queue_layout == LAYOUT_SEGMENTED)
+        q_compact(head);
+}
 
 /* Create an empty queue */
 struct list_head *q_new()
 {
-    struct list_head *head = malloc(sizeof(struct list_head));
+    queue_t *q = malloc(sizeof(queue_t));
 
-    if (!head) {
-        free(head);
+    if (!q)
         return NULL;
-    }
 
-    INIT_LIST_HEAD(head);
+    INIT_LIST_HEAD(&q->head);
+    q->size = 0;
+    q->heap_values = 0;
+    INIT_LIST_HEAD(&q->chunks);
+    INIT_LIST_HEAD(&q->free_elems);
+    q->index = NULL;
+    /* Seeded from rand() so that srand() in qtest still decides shuffles */
+    q->shuffle_state = (uintptr_t) rand() << 16 ^ (uintptr_t) rand();
 
-    return head;
+    return &q->head;
 }
 
 /* Free all storage used by queue */
@@ -38,13 +303,73 @@ void q_free(struct list_head *l)
     if (!l)
         return;
 
+    queue_t *q = queue_of(l);
+
+    /* Only values stored out of line need to be visited one by one */
+    if (q->heap_values) {
+        element_t *entry;
+        list_for_each_entry (entry, l, list) {
+            if (value_on_heap(entry))
+                free(entry->value);
+        }
+    }
+    test_slab_free(q->size);
+
+    struct q_chunk *c, *safe;
+    list_for_each_entry_safe (c, safe, &q->chunks, list)
+        free(c);
+
+    if (q->index) {
+        struct index_block *b = q->index->blocks, *next;
+        for (; b; b = next) {
+            next = b->next;
+            free(b);
+        }
+        free(q->index);
+    }
+    free(q);
+}
+
+/* Return an element to the slab it was carved from */
+void q_release_element(element_t *e)
+{
+    if (is_released(e)) {
+        test_slab_error("Attempted to release an element twice", e);
+        return;
+    }
+
+    if (value_on_heap(e))
+        free(e->value);
+    mark_released(e);
+    list_add(&e->list, &e->chunk->owner->free_elems);
+    test_slab_free(1);
+}
+
+/* Return a list of elements removed from one queue to its slab at once */
+void q_release_list(struct list_head *list)
+{
     element_t *entry, *safe;
+    size_t n = 0;
 
-    list_for_each_entry_safe (entry, safe, l, list) {
-        free(entry->value);
-        free(entry);
+    if (!list)
+        return;
+
+    list_for_each_entry_safe (entry, safe, list, list) {
+        if (is_released(entry)) {
+            test_slab_error("Attempted to release an element twice", entry);
+            list_del(&entry->list);
+            continue;
+        }
+        if (value_on_heap(entry))
+            free(entry->value);
+        mark_released(entry);
+        n++;
     }
-    free(l);
+    if (list_empty(list))
+        return;
+    queue_t *owner = list_first_entry(list, element_t, list)->chunk->owner;
+    list_splice_init(list, &owner->free_elems);
+    test_slab_free(n);
 }
 
 /* Insert an element at head of queue */
@@ -53,11 +378,12 @@ bool q_insert_head(struct list_head *head, char *s)
     if (__glibc_unlikely(!head || !s))
         return false;
 
-    element_t *node = new_node(s);
+    element_t *node = new_node(queue_of(head), s);
     if (!node)
         return false;
 
     list_add(&node->list, head);
+    account_insert(queue_of(head), node);
 
     return true;
 }
@@ -68,16 +394,242 @@ bool q_insert_tail(struct list_head *head, char *s)
     if (__glibc_unlikely(!head || !s))
         return false;
 
-    element_t *node = new_node(s);
+    element_t *node = new_node(queue_of(head), s);
     if (!node) {
         return false;
     }
 
     list_add_tail(&node->list, head);
+    account_insert(queue_of(head), node);
+
+    return true;
+}
+
+/* Insert n strings, repeated reps times, at tail of queue at once */
+bool q_insert_tail_batch(struct list_head *head, char **sv, int n, int reps)
+{
+    if (__glibc_unlikely(!head || !sv || n <= 0 || reps <= 0))
+        return false;
+
+    queue_t *q = queue_of(head);
+    size_t count = (size_t) n * reps, pool_size = 0;
+    if (count > INT_MAX - q->size)
+        return false;
+
+    /* Values which do not fit in an element share one pool */
+    for (int i = 0; i < n; i++) {
+        size_t len = strlen(sv[i]) + 1;
+        if (len > Q_INLINE_LEN)
+            pool_size += len * reps;
+    }
+
+    /* All the elements and their values live in a single chunk */
+    struct q_chunk *c =
+        malloc(sizeof(struct q_chunk) + count * sizeof(element_t) + pool_size);
+    if (!c)
+        return false;
+    if (!test_slab_alloc(count)) {
+        free(c);
+        return false;
+    }
+    c->owner = q;
+    c->capacity = c->used = count;
+    c->pool_size = pool_size;
+    list_add(&c->list, &q->chunks);
+
+    /* Link the chain in place and splice it in one step */
+    LIST_HEAD(batch);
+    struct list_head *prev = &batch;
+    char *pool = chunk_pool(c);
+    element_t *e = c->elems;
+    for (int r = 0; r < reps; r++) {
+        for (int i = 0; i < n; i++, e++) {
+            size_t len = strlen(sv[i]) + 1;
+
+            e->chunk = c;
+            e->key = q_key(sv[i]);
+            if (len <= sizeof(e->buf)) {
+                e->value = memcpy(e->buf, sv[i], len);
+            } else {
+                e->value = memcpy(pool, sv[i], len);
+                pool += len;
+            }
+            e->list.prev = prev;
+            prev->next = &e->list;
+            prev = &e->list;
+        }
+    }
+    prev->next = &batch;
+    batch.prev = prev;
+    list_splice_tail(&batch, head);
+    q->size += count;
+    index_invalidate(q);
 
     return true;
 }
 
+/* Height of a new node of the skip list, 0 for an element getting no node */
+static int index_height(void)
+{
+    static uint64_t state = 0x9e3779b97f4a7c15ULL;
+    int height = 0;
+
+    /* xorshift64 */
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    for (uint64_t r = state; !(r & 3) && height < INDEX_LEVELS; r >>= 2)
+        height++;
+    return height;
+}
+
+/* Carve a node of the given height out of the blocks of the index */
+static struct index_node *index_node_alloc(struct q_index *idx, int height)
+{
+    size_t size = sizeof(struct index_node) + height * sizeof(void *);
+
+    if (!idx->cur || idx->used + size > INDEX_BLOCK) {
+        struct index_block *b = idx->cur ? idx->cur->next : idx->blocks;
+        if (!b) {
+            b = malloc(sizeof(struct index_block));
+            if (!b)
+                return NULL;
+            b->next = NULL;
+            if (idx->cur)
+                idx->cur->next = b;
+            else
+                idx->blocks = b;
+        }
+        idx->cur = b;
+        idx->used = 0;
+    }
+
+    struct index_node *node = (struct index_node *) &idx->cur->mem[idx->used];
+    idx->used += size;
+    return node;
+}
+
+/* Build the index of the queue from scratch, reusing its blocks */
+static struct q_index *index_build(queue_t *q, bool descend)
+{
+    struct q_index *idx = q->index;
+
+    if (!idx) {
+        idx = malloc(sizeof(struct q_index));
+        if (!idx)
+            return NULL;
+        idx->blocks = NULL;
+        q->index = idx;
+    }
+    idx->descend = descend;
+    idx->levels = 0;
+    idx->cur = NULL;
+    idx->used = 0;
+
+    struct index_node **tails[INDEX_LEVELS];
+    for (int lvl = 0; lvl < INDEX_LEVELS; lvl++) {
+        idx->heads[lvl] = NULL;
+        tails[lvl] = &idx->heads[lvl];
+    }
+
+    element_t *e;
+    list_for_each_entry (e, &q->head, list) {
+        int height = index_height();
+        /* An element left out only makes the search walk a bit longer */
+        struct index_node *node = height ? index_node_alloc(idx, height) : NULL;
+        if (!node)
+            continue;
+        node->e = e;
+        for (int lvl = 0; lvl < height; lvl++) {
+            node->next[lvl] = NULL;
+            *tails[lvl] = node;
+            tails[lvl] = &node->next[lvl];
+        }
+        if (height > idx->levels)
+            idx->levels = height;
+    }
+    idx->valid = true;
+
+    return idx;
+}
+
+/* Whether e goes after the element at pos in a queue sorted in that order */
+static inline bool goes_after(const element_t *e,
+                              const element_t *pos,
+                              bool descend)
+{
+    int cmp = q_compare(pos, e);
+    return descend ? cmp >= 0 : cmp <= 0;
+}
+
+/* Insert an element at its place in a sorted queue */
+bool q_insert_sorted(struct list_head *head, char *s, bool descend)
+{
+    if (__glibc_unlikely(!head || !s))
+        return false;
+
+    queue_t *q = queue_of(head);
+    element_t *node = new_node(q, s);
+    if (!node)
+        return false;
+
+    struct q_index *idx = q->index;
+    if (!idx || !idx->valid || idx->descend != descend)
+        idx = index_build(q, descend);
+
+    /* Find the last node not after the new element on each level, where
+     * update[lvl] is the link the new node would be put on.
+     */
+    struct index_node **update[INDEX_LEVELS];
+    struct index_node *prev = NULL;
+    for (int lvl = (idx ? idx->levels : 0) - 1; lvl >= 0; lvl--) {
+        struct index_node **link = prev ? &prev->next[lvl] : &idx->heads[lvl];
+        while (*link && goes_after(node, (*link)->e, descend)) {
+            prev = *link;
+            link = &prev->next[lvl];
+        }
+        update[lvl] = link;
+    }
+
+    /* Level 0 is the queue itself */
+    struct list_head *pos = prev ? &prev->e->list : head;
+    while (pos->next != head &&
+           goes_after(node, list_entry(pos->next, element_t, list), descend))
+        pos = pos->next;
+    list_add(&node->list, pos);
+
+    /* Not through account_insert(), which would drop the index */
+    q->size++;
+    if (value_on_heap(node))
+        q->heap_values++;
+
+    if (!idx)
+        return true;
+
+    int height = index_height();
+    struct index_node *in = height ? index_node_alloc(idx, height) : NULL;
+    if (!in)
+        return true;
+    in->e = node;
+    for (int lvl = 0; lvl < height; lvl++) {
+        struct index_node **link =
+            lvl < idx->levels ? update[lvl] : &idx->heads[lvl];
+        in->next[lvl] = *link;
+        *link = in;
+    }
+    if (height > idx->levels)
+        idx->levels = height;
+
+    return true;
+}
+
+/* Drop the index of a queue reordered without the q_* functions */
+void q_drop_index(struct list_head *head)
+{
+    if (head)
+        index_invalidate(queue_of(head));
+}
+
 /* Remove an element from head of queue */
 element_t *q_remove_head(struct list_head *head, char *sp, size_t bufsize)
 {
@@ -88,6 +640,7 @@ element_t *q_remove_head(struct list_head *head, char *sp, size_t bufsize)
     element_t *node = list_entry(first_ptr, element_t, list);
 
     list_del(first_ptr);
+    account_remove(queue_of(head), node);
 
     if (sp) {
         strncpy(sp, node->value, bufsize);
@@ -108,6 +661,7 @@ element_t *q_remove_tail(struct list_head *head, char *sp, size_t bufsize)
     element_t *node = list_entry(last_ptr, element_t, list);
 
     list_del(last_ptr);
+    account_remove(queue_of(head), node);
 
     if (sp) {
         strncpy(sp, node->value, bufsize);
@@ -118,19 +672,116 @@ element_t *q_remove_tail(struct list_head *head, char *sp, size_t bufsize)
     return node;
 }
 
+/* Append value to the packed buffer of *left bytes at *sp, truncated to fit */
+static inline void pack_value(char **sp, size_t *left, const char *value)
+{
+    if (!*left)
+        return;
+
+    size_t len = strnlen(value, *left - 1);
+    memcpy(*sp, value, len);
+    (*sp)[len] = '\0';
+    *sp += len + 1;
+    *left -= len + 1;
+}
+
+/* Walk n elements from either end of the queue, which are about to be
+ * removed, packing their values into sp.  Return the last element walked.
+ */
+static struct list_head *walk_n(struct list_head *head,
+                                int n,
+                                bool from_tail,
+                                char *sp,
+                                size_t bufsize)
+{
+    queue_t *q = queue_of(head);
+    struct list_head *node = head;
+
+    if (!sp)
+        bufsize = 0;
+    for (int i = 0; i < n; i++) {
+        node = from_tail ? node->prev : node->next;
+        element_t *e = list_entry(node, element_t, list);
+        if (value_on_heap(e))
+            q->heap_values--;
+        pack_value(&sp, &bufsize, e->value);
+    }
+    q->size -= n;
+    index_invalidate(q);
+
+    return node;
+}
+
+/* Remove the first n elements of queue at once */
+int q_remove_head_n(struct list_head *head,
+                    struct list_head *list,
+                    int n,
+                    char *sp,
+                    size_t bufsize)
+{
+    if (__glibc_unlikely(!list))
+        return 0;
+    INIT_LIST_HEAD(list);
+    if (__glibc_unlikely(!head || n <= 0 || list_empty(head)))
+        return 0;
+
+    queue_t *q = queue_of(head);
+    if (n >= q->size && !sp) {
+        /* Draining the whole queue does not need to visit the elements */
+        n = q->size;
+        list_splice_init(head, list);
+        q->size = q->heap_values = 0;
+        index_invalidate(q);
+        return n;
+    }
+    if (n > q->size)
+        n = q->size;
+
+    list_cut_position(list, head, walk_n(head, n, false, sp, bufsize));
+    return n;
+}
+
+/* Remove the last n elements of queue at once */
+int q_remove_tail_n(struct list_head *head,
+                    struct list_head *list,
+                    int n,
+                    char *sp,
+                    size_t bufsize)
+{
+    if (__glibc_unlikely(!list))
+        return 0;
+    INIT_LIST_HEAD(list);
+    if (__glibc_unlikely(!head || n <= 0 || list_empty(head)))
+        return 0;
+
+    queue_t *q = queue_of(head);
+    if (n > q->size)
+        n = q->size;
+
+    LIST_HEAD(front);
+    list_cut_position(&front, head, walk_n(head, n, true, sp, bufsize)->prev);
+    list_splice_init(head, list);
+    list_splice_init(&front, head);
+    return n;
+}
+
 /* Return number of elements in queue */
 int q_size(struct list_head *head)
 {
     if (!head)
         return 0;
 
-    int len = 0;
-    struct list_head *li;
+    return queue_of(head)->size;
+}
 
-    list_for_each (li, head)
-        len++;
+/* Unlink the element at node and return it to the slab */
+static void delete_node(struct list_head *head, struct list_head *node)
+{
+    element_t *e = list_entry(node, element_t, list);
 
-    return len;
+    list_del(node);
+    account_remove(queue_of(head), e);
+    q_release_element(e);
 }
 
 /* Delete the middle node in queue */
@@ -140,18 +791,39 @@ bool q_delete_mid(struct list_head *head)
     if (!head || list_empty(head))
         return false;
 
-    int mid;
-    struct list_head *mid_ptr = head->next;
+    /* The node at index ⌊n / 2⌋ is the ⌈n / 2⌉th one from the tail, so
+     * walking back from the tail with the cached size takes ⌈n / 2⌉ steps.
+     */
+    int size = queue_of(head)->size;
+    struct list_head *node = head;
+    for (int i = size - size / 2; i > 0; i--)
+        node = node->prev;
+    delete_node(head, node);
 
-    mid = q_size(head) / 2;
-    for (int i = 0; i < mid; ++i) {
-        mid_ptr = mid_ptr->next;
-    }
-    list_del(mid_ptr);
+    return true;
+}
 
-    element_t *node = list_entry(mid_ptr, element_t, list);
-    free(node->value);
-    free(node);
+/* Delete the node at the given fraction of the queue */
+bool q_delete_at(struct list_head *head, double ratio)
+{
+    if (!head || list_empty(head) || !(ratio >= 0 && ratio <= 1))
+        return false;
+
+    /* Walk from the nearer end, which takes at most n / 2 steps */
+    int size = queue_of(head)->size;
+    int idx = ratio * size;
+    if (idx >= size)
+        idx = size - 1;
+
+    struct list_head *node = head;
+    if (idx < size / 2) {
+        for (int i = 0; i <= idx; i++)
+            node = node->next;
+    } else {
+        for (int i = size - 1; i >= idx; i--)
+            node = node->prev;
+    }
+    delete_node(head, node);
 
     return true;
 }
@@ -169,22 +841,111 @@ bool q_delete_dup(struct list_head *head)
     list_for_each_safe (node, safe, head) {
         element_t *entry = list_entry(node, element_t, list);
         if (safe != head &&
-            !strcmp(entry->value, list_entry(safe, element_t, list)->value)) {
+            !q_compare(entry, list_entry(safe, element_t, list))) {
             last_dup = true;
             list_del(node);
-            free(entry->value);
-            free(entry);
+            account_remove(queue_of(head), entry);
+            q_release_element(entry);
         } else if (last_dup) {
             last_dup = false;
             list_del(node);
-            free(entry->value);
-            free(entry);
+            account_remove(queue_of(head), entry);
+            q_release_element(entry);
         }
     }
 
     return true;
 }
 
+/**
+ * dup_slot_t - Slot of an element in the table of q_delete_dup_unsorted()
+ * @node: node in the bucket of the string, if the element is its first copy
+ * @e: the element
+ * @first: slot of the first copy of the same string
+ * @count: number of copies, kept in the slot of the first copy
+ */
+typedef struct dup_slot {
+    struct hlist_node node;
+    element_t *e;
+    struct dup_slot *first;
+    int count;
+} dup_slot_t;
+
+/* Hash of the whole string, seeded by the cached prefix */
+static inline uint64_t value_hash(const element_t *e)
+{
+    uint64_t h = e->key * 0x9e3779b97f4a7c15ULL;
+
+    /* The prefix holds the first 8 bytes unless the string is shorter */
+    if (e->key & 0xff) {
+        for (const unsigned char *p = (unsigned char *) e->value + 8; *p; p++)
+            h = (h ^ *p) * 0x100000001b3ULL;
+    }
+    return h ^ (h >> 29);
+}
+
+/* Delete all nodes that have duplicate string, wherever the copies are */
+bool q_delete_dup_unsorted(struct list_head *head)
+{
+    if (!head || list_empty(head))
+        return false;
+
+    queue_t *q = queue_of(head);
+    size_t nbuckets = 1;
+    while (nbuckets < (size_t) q->size)
+        nbuckets <<= 1;
+
+    struct hlist_head *buckets = malloc(nbuckets * sizeof(*buckets));
+    dup_slot_t *slots = malloc(q->size * sizeof(*slots));
+    if (!buckets || !slots) {
+        free(buckets);
+        free(slots);
+        return false;
+    }
+    for (size_t i = 0; i < nbuckets; i++)
+        INIT_HLIST_HEAD(&buckets[i]);
+
+    /* Count the copies of every string */
+    dup_slot_t *slot = slots;
+    element_t *entry, *safe;
+    list_for_each_entry (entry, head, list) {
+        struct hlist_head *b = &buckets[value_hash(entry) & (nbuckets - 1)];
+        dup_slot_t *first;
+
+        slot->e = entry;
+        slot->first = NULL;
+        hlist_for_each_entry (first, b, node) {
+            if (!q_compare(first->e, entry)) {
+                slot->first = first;
+                first->count++;
+                break;
+            }
+        }
+        if (!slot->first) {
+            slot->first = slot;
+            slot->count = 1;
+            hlist_add_head(&slot->node, b);
+        }
+        slot++;
+    }
+
+    /* Remove the strings seen more than once, keeping the order of the rest */
+    LIST_HEAD(removed);
+    slot = slots;
+    list_for_each_entry_safe (entry, safe, head, list) {
+        if (slot->first->count > 1) {
+            list_move_tail(&entry->list, &removed);
+            account_remove(q, entry);
+        }
+        slot++;
+    }
+    q_release_list(&removed);
+
+    free(buckets);
+    free(slots);
+    return true;
+}
+
 /* Swap every two adjacent nodes */
 // https://leetcode.com/problems/swap-nodes-in-pairs/
 void q_swap(struct list_head *head)
@@ -196,7 +957,7 @@ void q_swap(struct list_head *head)
 
     list_for_each_safe (node, safe, head) {
         if (safe == head)
-            return;
+            break;
 
         node->prev->next = safe;
         safe->next->prev = node;
@@ -207,6 +968,7 @@ void q_swap(struct list_head *head)
 
         safe = node->next;
     }
+    reordered(head);
 }
 
 /* Reverse elements in queue */
@@ -220,45 +982,44 @@ void q_reverse(struct list_head *head)
     list_for_each_safe (node, safe, head) {
         list_move(node, head);
     }
-
-    return;
+    reordered(head);
 }
 
 /* Reverse the nodes of the list k at a time */
 // https://leetcode.com/problems/reverse-nodes-in-k-group/
 void q_reverseK(struct list_head *head, int k)
 {
-    if (!head || list_empty(head))
-        return;
-
-    if (k == 1) {
-        q_reverse(head);
+    if (!head || list_empty(head) || k <= 1)
         return;
-    }
 
-    struct list_head *node, *safe;
+    /* Walk forward once, moving every node right behind anchor, the node
+     * before the current group.  This reverses the group in place, and once
+     * it is complete its first node, now its last one, anchors the next.
+     */
+    struct list_head *anchor = head, *first = head->next, *node = first;
     int count = 0;
-    LIST_HEAD(temp);
 
-    q_reverse(head);
-    list_splice_tail_init(head, &temp);
+    while (node != head) {
+        struct list_head *next = node->next;
 
-    list_for_each_safe_reverse(node, safe, &temp)
-    {
-        count++;
-        if (count == k) {
-            LIST_HEAD(remains);
-            list_cut_position(&remains, &temp, safe);
-            list_splice_tail_init(&temp, head);
-            list_splice_tail(&remains, &temp);
+        list_move(node, anchor);
+        if (++count == k) {
+            anchor = first;
+            first = next;
             count = 0;
         }
+        node = next;
     }
 
-    if (!list_empty(&temp)) {
-        q_reverse(&temp);
-        list_splice_tail(&temp, head);
+    /* A trailing group shorter than k keeps its order, so turn it back */
+    if (count) {
+        for (node = anchor->next; node != head;) {
+            struct list_head *next = node->next;
+            list_move(node, anchor);
+            node = next;
+        }
     }
+    reordered(head);
 }
 
 void merge_two_sorted_list(struct list_head *left_head,
@@ -271,12 +1032,12 @@ void merge_two_sorted_list(struct list_head *left_head,
         element_t *right_entry = list_entry(right_head->next, element_t, list);
 
         if (!descend) {
-            if (strcmp(left_entry->value, right_entry->value) <= 0)
+            if (q_compare(left_entry, right_entry) <= 0)
                 list_move_tail(left_head->next, head);
             else
                 list_move_tail(right_head->next, head);
         } else {
-            if (strcmp(left_entry->value, right_entry->value) >= 0)
+            if (q_compare(left_entry, right_entry) >= 0)
                 list_move_tail(left_head->next, head);
             else
                 list_move_tail(right_head->next, head);
@@ -289,10 +1050,10 @@ void merge_two_sorted_list(struct list_head *left_head,
         list_splice_tail_init(left_head, head);
 }
 
-/* Sort elements of queue in ascending/descending order */
-void q_sort(struct list_head *head, bool descend)
+/* Recursive top-down merge sort */
+static void sort_top_down(struct list_head *head, bool descend)
 {
-    if (!head || list_empty(head) || list_is_singular(head))
+    if (list_empty(head) || list_is_singular(head))
         return;
 
     struct list_head *slow = head, *fast = head;
@@ -307,11 +1068,347 @@ void q_sort(struct list_head *head, bool descend)
     list_splice_tail_init(head, &right_head);
     list_cut_position(&left_head, &right_head, slow);
 
-    q_sort(&left_head, descend);
-    q_sort(&right_head, descend);
+    sort_top_down(&left_head, descend);
+    sort_top_down(&right_head, descend);
     merge_two_sorted_list(&left_head, &right_head, head, descend);
 }
 
+/* Whether node a may stay in front of node b in the sorted order */
+static inline bool in_order(const struct list_head *a,
+                            const struct list_head *b,
+                            bool descend)
+{
+    int r = q_compare(list_entry(a, element_t, list),
+                      list_entry(b, element_t, list));
+    return descend ? r >= 0 : r <= 0;
+}
+
+/* Merge two sorted, null-terminated runs linked through their next pointers.
+ * Ties are taken from a, which must hold the earlier elements.
+ */
+static struct list_head *merge_runs(struct list_head *a,
+                                    struct list_head *b,
+                                    bool descend)
+{
+    struct list_head *head = NULL, **tail = &head;
+
+    while (a && b) {
+        if (in_order(a, b, descend)) {
+            *tail = a;
+            a = a->next;
+        } else {
+            *tail = b;
+            b = b->next;
+        }
+        tail = &(*tail)->next;
+    }
+    *tail = a ? a : b;
+
+    return head;
+}
+
+/* Iterative bottom-up merge sort of a null-terminated list.
+ * runs[i] is either NULL or a sorted run of 2^i elements, and runs at higher
+ * slots hold earlier elements.  Adding an element works like incrementing a
+ * binary counter, merging equally long runs as the carry propagates, so no
+ * midpoint has to be searched for and no recursion is involved.
+ */
+static struct list_head *sort_run(struct list_head *list, bool descend)
+{
+    struct list_head *runs[sizeof(size_t) * 8] = {NULL};
+    struct list_head *sorted = NULL;
+    int nruns = 0;
+
+    while (list) {
+        struct list_head *carry = list;
+        int i;
+
+        list = list->next;
+        carry->next = NULL;
+        for (i = 0; runs[i]; i++) {
+            carry = merge_runs(runs[i], carry, descend);
+            runs[i] = NULL;
+        }
+        runs[i] = carry;
+        if (i >= nruns)
+            nruns = i + 1;
+    }
+
+    for (int i = 0; i < nruns; i++) {
+        if (runs[i])
+            sorted = sorted ? merge_runs(runs[i], sorted, descend) : runs[i];
+    }
+
+    return sorted;
+}
+
+/* Link a null-terminated list back to head, rebuilding the prev links */
+static void relink(struct list_head *head, struct list_head *list)
+{
+    struct list_head *prev = head;
+
+    for (struct list_head *node = list; node; node = node->next) {
+        node->prev = prev;
+        prev->next = node;
+        prev = node;
+    }
+    prev->next = head;
+    head->prev = prev;
+}
+
+static void sort_bottom_up(struct list_head *head, bool descend)
+{
+    /* Convert to a null-terminated singly-linked list */
+    head->prev->next = NULL;
+    relink(head, sort_run(head->next, descend));
+}
+
+/* Radix sort hands buckets smaller than this to the merge sort */
+#define RADIX_MIN 64
+
+/* MSD radix sort of a null-terminated list of n nodes whose keys agree on the
+ * bytes before depth.  Nodes are distributed by the byte of the cached key at
+ * depth into 256 buckets, appending to keep them stable, and each bucket is
+ * sorted on the next byte.  Small buckets, and buckets past the prefix, go to
+ * the merge sort.  The last node of the result is stored in *last.
+ */
+static struct list_head *sort_radix_run(struct list_head *list,
+                                        size_t n,
+                                        int depth,
+                                        bool descend,
+                                        struct list_head **last)
+{
+    if (n < RADIX_MIN || depth == sizeof(uint64_t)) {
+        list = sort_run(list, descend);
+        for (*last = list; (*last)->next; *last = (*last)->next)
+            ;
+        return list;
+    }
+
+    struct list_head *heads[256], **tails[256];
+    size_t counts[256] = {0};
+    int shift = 56 - 8 * depth;
+
+    for (int b = 0; b < 256; b++)
+        tails[b] = &heads[b];
+    for (struct list_head *node = list; node; node = node->next) {
+        int b = (list_entry(node, element_t, list)->key >> shift) & 0xff;
+        *tails[b] = node;
+        tails[b] = &node->next;
+        counts[b]++;
+    }
+
+    struct list_head *sorted = NULL, **tail = &sorted;
+    for (int i = 0; i < 256; i++) {
+        int b = descend ? 255 - i : i;
+        if (!counts[b])
+            continue;
+
+        *tails[b] = NULL;
+        struct list_head *bucket_last;
+        if (b) {
+            *tail = sort_radix_run(heads[b], counts[b], depth + 1, descend,
+                                   &bucket_last);
+        } else {
+            /* The strings ended before depth, so they are all equal */
+            *tail = heads[b];
+            bucket_last = container_of(tails[b], struct list_head, next);
+        }
+        tail = &bucket_last->next;
+        *last = bucket_last;
+    }
+    *tail = NULL;
+
+    return sorted;
+}
+
+static void sort_radix(struct list_head *head, bool descend)
+{
+    struct list_head *node, *last;
+    size_t n = 0;
+
+    list_for_each (node, head)
+        n++;
+    head->prev->next = NULL;
+    relink(head, sort_radix_run(head->next, n, 0, descend, &last));
+}
+
+/* Parallel sort does not split lists into parts shorter than this */
+#define PARALLEL_MIN_PART 4096
+
+int sort_threads = 4;
+
+/**
+ * sort_job_t - Unit of work handed to a thread by the parallel sort
+ * @a: null-terminated list to sort, or the earlier run to merge
+ * @b: the later run to merge, NULL when @a is to be sorted
+ * @descend: whether to sort in descending order
+ * @tid: the thread running the job
+ * @started: whether @tid was created
+ *
+ * The result is left in @a.
+ */
+typedef struct {
+    struct list_head *a, *b;
+    bool descend;
+    pthread_t tid;
+    bool started;
+} sort_job_t;
+
+static void *sort_worker(void *arg)
+{
+    sort_job_t *job = arg;
+
+    if (job->b)
+        job->a = merge_runs(job->a, job->b, job->descend);
+    else
+        job->a = sort_run(job->a, job->descend);
+    return NULL;
+}
+
+/* Run the jobs concurrently, the last one in the calling thread.  Jobs whose
+ * thread cannot be created run in the calling thread as well.
+ */
+static void run_jobs(sort_job_t *jobs, int n)
+{
+    sigset_t all, old;
+
+    /* Workers leave every signal, such as SIGALRM of the harness, to the
+     * calling thread.
+     */
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    for (int i = 0; i < n - 1; i++)
+        jobs[i].started =
+            !pthread_create(&jobs[i].tid, NULL, sort_worker, &jobs[i]);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    sort_worker(&jobs[n - 1]);
+    for (int i = 0; i < n - 1; i++) {
+        if (jobs[i].started)
+            pthread_join(jobs[i].tid, NULL);
+        else
+            sort_worker(&jobs[i]);
+    }
+}
+
+/* Split the list into sort_threads parts of nearly equal length, sort them
+ * concurrently with the bottom-up merge sort, and merge neighbouring runs
+ * pairwise in parallel rounds.  Earlier runs always stay on the left side of
+ * a merge, so the result is stable.
+ */
+static void sort_parallel(struct list_head *head, bool descend)
+{
+    sort_job_t jobs[PARALLEL_MAX_THREADS], merges[PARALLEL_MAX_THREADS / 2];
+    struct list_head *node;
+    size_t n = 0;
+    int nthreads = sort_threads, cap = PARALLEL_MAX_THREADS;
+
+    list_for_each (node, head)
+        n++;
+    /* Keep the comparison signed, so a negative count cannot turn huge */
+    if (n / PARALLEL_MIN_PART < (size_t) cap)
+        cap = n / PARALLEL_MIN_PART;
+    if (nthreads > cap)
+        nthreads = cap;
+    if (nthreads < 2) {
+        sort_bottom_up(head, descend);
+        return;
+    }
+
+    head->prev->next = NULL;
+    node = head->next;
+    for (int i = 0; i < nthreads; i++) {
+        size_t len = n / nthreads + (i < n % nthreads);
+
+        jobs[i].a = node;
+        jobs[i].b = NULL;
+        jobs[i].descend = descend;
+        for (size_t j = 1; j < len; j++)
+            node = node->next;
+        struct list_head *next = node->next;
+        node->next = NULL;
+        node = next;
+    }
+
+    /* A time limit hit while the workers still use the list would unwind the
+     * stack under them, so hold SIGALRM until they are done.
+     */
+    sigset_t alarm_set, old;
+    sigemptyset(&alarm_set);
+    sigaddset(&alarm_set, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &alarm_set, &old);
+
+    run_jobs(jobs, nthreads);
+    for (int step = 1; step < nthreads; step *= 2) {
+        int m = 0;
+
+        for (int i = 0; i + step < nthreads; i += 2 * step) {
+            merges[m].a = jobs[i].a;
+            merges[m].b = jobs[i + step].a;
+            merges[m].descend = descend;
+            m++;
+        }
+        run_jobs(merges, m);
+        for (int i = 0, k = 0; i + step < nthreads; i += 2 * step)
+            jobs[i].a = merges[k++].a;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    relink(head, jobs[0].a);
+}
+
+/* Sort elements of queue in ascending/descending order */
+void q_sort(struct list_head *head, bool descend)
+{
+    if (!head || list_empty(head) || list_is_singular(head))
+        return;
+
+    switch (sort_mode) {
+    case SORT_BOTTOM_UP:
+        sort_bottom_up(head, descend);
+        break;
+    case SORT_PARALLEL:
+        sort_parallel(head, descend);
+        break;
+    case SORT_RADIX:
+        sort_radix(head, descend);
+        break;
+    default:
+        sort_top_down(head, descend);
+        break;
+    }
+    reordered(head);
+}
+
+/* Remove every node which has a node after it that sorts strictly before it,
+ * where descend flips the order.  A single pass from the tail keeps track of
+ * the least kept element so far, so each node is compared exactly once.
+ */
+static int remove_dominated(struct list_head *head, bool descend)
+{
+    queue_t *q = queue_of(head);
+    struct list_head *node, *safe;
+    element_t *least = NULL;
+    LIST_HEAD(removed);
+
+    list_for_each_safe_reverse(node, safe, head)
+    {
+        element_t *entry = list_entry(node, element_t, list);
+        int r = least ? q_compare(entry, least) : 0;
+
+        if (descend ? r < 0 : r > 0) {
+            list_move(node, &removed);
+            account_remove(q, entry);
+        } else {
+            least = entry;
+        }
+    }
+
+    q_release_list(&removed);
+    return q->size;
+}
+
 /* Remove every node which has a node with a strictly less value anywhere to
  * the right side of it */
 // https://leetcode.com/problems/remove-nodes-from-linked-list/
@@ -319,42 +1416,8 @@ int q_ascend(struct list_head *head)
 {
     if (!head || list_empty(head))
         return 0;
-    if (list_is_singular(head))
-        return 1;
-
-    int size = 1;
-    struct list_head *node, *head_safe, *first = head->next;
-    element_t *temp_entry, *temp_safe;
-    LIST_HEAD(temp);
-
-    list_splice_tail_init(head, &temp);
-    list_cut_position(head, &temp, first);
-
-    list_for_each_entry_safe (temp_entry, temp_safe, &temp, list) {
-        list_for_each_safe_reverse(node, head_safe, head)
-        {
-            element_t *head_entry = list_entry(node, element_t, list);
-
-            if (strcmp(temp_entry->value, head_entry->value) < 0) {
-                list_del(node);
-                free(head_entry->value);
-                free(head_entry);
-                size--;
-
-                if (head_safe == head) {
-                    list_move_tail(&temp_entry->list, head);
-                    size++;
-                    break;
-                }
-            } else {
-                list_move_tail(&temp_entry->list, head);
-                size++;
-                break;
-            }
-        }
-    }
 
-    return size;
+    return remove_dominated(head, false);
 }
 
 /* Remove every node which has a node with a strictly greater value anywhere to
@@ -364,42 +1427,150 @@ int q_descend(struct list_head *head)
 {
     if (!head || list_empty(head))
         return 0;
-    if (list_is_singular(head))
-        return 1;
-
-    int size = 1;
-    struct list_head *node, *head_safe, *first = head->next;
-    element_t *temp_entry, *temp_safe;
-    LIST_HEAD(temp);
-
-    list_splice_tail_init(head, &temp);
-    list_cut_position(head, &temp, first);
-
-    list_for_each_entry_safe (temp_entry, temp_safe, &temp, list) {
-        list_for_each_safe_reverse(node, head_safe, head)
-        {
-            element_t *head_entry = list_entry(node, element_t, list);
-
-            if (strcmp(temp_entry->value, head_entry->value) > 0) {
-                list_del(node);
-                free(head_entry->value);
-                free(head_entry);
-                size--;
-
-                if (head_safe == head) {
-                    list_move_tail(&temp_entry->list, head);
-                    size++;
-                    break;
-                }
-            } else {
-                list_move_tail(&temp_entry->list, head);
-                size++;
-                break;
-            }
+
+    return remove_dominated(head, true);
+}
+
+/* q_merge() does not split runs across more heap entries than this */
+#define MERGE_HEAP_MAX 1024
+
+int merge_mode = MERGE_HEAP;
+
+/* Front of a sorted, null-terminated run and the position of its queue */
+typedef struct {
+    struct list_head *node;
+    int idx;
+} merge_src_t;
+
+/* Whether the front of a goes before the front of b, earlier queues first */
+static inline bool src_before(const merge_src_t *a,
+                              const merge_src_t *b,
+                              bool descend)
+{
+    int r = q_compare(list_entry(a->node, element_t, list),
+                      list_entry(b->node, element_t, list));
+    if (descend)
+        r = -r;
+    return r < 0 || (!r && a->idx < b->idx);
+}
+
+static void heap_sift_down(merge_src_t *heap, int n, int i, bool descend)
+{
+    merge_src_t top = heap[i];
+
+    for (int c; (c = 2 * i + 1) < n; i = c) {
+        if (c + 1 < n && src_before(&heap[c + 1], &heap[c], descend))
+            c++;
+        if (!src_before(&heap[c], &top, descend))
+            break;
+        heap[i] = heap[c];
+    }
+    heap[i] = top;
+}
+
+/* Merge n non-empty runs through a binary min-heap of their fronts */
+static struct list_head *merge_heap(merge_src_t *heap, int n, bool descend)
+{
+    struct list_head *head = NULL, **tail = &head;
+
+    for (int i = n / 2 - 1; i >= 0; i--)
+        heap_sift_down(heap, n, i, descend);
+
+    while (n > 1) {
+        *tail = heap[0].node;
+        tail = &(*tail)->next;
+        heap[0].node = heap[0].node->next;
+        if (!heap[0].node)
+            heap[0] = heap[--n];
+        heap_sift_down(heap, n, 0, descend);
+    }
+    *tail = n ? heap[0].node : NULL;
+
+    return head;
+}
+
+/* Fold a full round's result into the counter of rounds, as sort_run() does
+ * with single elements, so the result of 2^i rounds lands in rounds[i] and
+ * every element takes part in O(log(k / MERGE_HEAP_MAX)) two-way merges.
+ */
+static void push_round(struct list_head **rounds,
+                       struct list_head *carry,
+                       bool descend)
+{
+    int i;
+
+    for (i = 0; rounds[i]; i++) {
+        carry = merge_runs(rounds[i], carry, descend);
+        rounds[i] = NULL;
+    }
+    rounds[i] = carry;
+}
+
+/* k-way merge of all the queues into a null-terminated list, which leaves
+ * the queues empty.  With more queues than MERGE_HEAP_MAX, each full heap is
+ * merged on its own and the results of the rounds are merged pairwise.
+ */
+static struct list_head *merge_by_heap(struct list_head *head, bool descend)
+{
+    merge_src_t heap[MERGE_HEAP_MAX];
+    struct list_head *rounds[sizeof(size_t) * 8] = {NULL};
+    struct list_head *merged;
+    queue_contex_t *ctx;
+    int n = 0;
+
+    list_for_each_entry (ctx, head, chain) {
+        if (list_empty(ctx->q))
+            continue;
+        if (n == MERGE_HEAP_MAX) {
+            push_round(rounds, merge_heap(heap, n, descend), descend);
+            n = 0;
         }
+        ctx->q->prev->next = NULL;
+        heap[n].node = ctx->q->next;
+        heap[n].idx = n;
+        n++;
+        INIT_LIST_HEAD(ctx->q);
     }
 
-    return size;
+    /* Later rounds sit in lower slots, so fold upwards keeping ties stable */
+    merged = n ? merge_heap(heap, n, descend) : NULL;
+    for (size_t i = 0; i < sizeof(rounds) / sizeof(rounds[0]); i++) {
+        if (rounds[i])
+            merged = merged ? merge_runs(rounds[i], merged, descend)
+                            : rounds[i];
+    }
+
+    return merged;
+}
+
+/* Merge neighbouring queues in rounds until the first one holds everything.
+ * The i-th round merges queues 2^i apart, so every element takes part in
+ * about log2(k) merges for k queues.
+ */
+static void merge_pairwise(struct list_head *head, int k, bool descend)
+{
+    LIST_HEAD(merged);
+
+    for (int step = 1; step < k; step *= 2) {
+        struct list_head *a = head->next;
+
+        while (a != head) {
+            struct list_head *b = a;
+            for (int i = 0; i < step && b != head; i++)
+                b = b->next;
+            if (b == head)
+                break;
+
+            struct list_head *qa = list_entry(a, queue_contex_t, chain)->q;
+            merge_two_sorted_list(qa, list_entry(b, queue_contex_t, chain)->q,
+                                  &merged, descend);
+            list_splice_init(&merged, qa);
+
+            a = b;
+            for (int i = 0; i < step && a != head; i++)
+                a = a->next;
+        }
+    }
 }
 
 /* Merge all the queues into one sorted queue, which is in ascending/descending
@@ -413,41 +1584,57 @@ int q_merge(struct list_head *head, bool descend)
     if (list_is_singular(head))
         return q_size(list_first_entry(head, queue_contex_t, chain)->q);
 
-    LIST_HEAD(ans);
     queue_contex_t *q_ptr = NULL;
-    queue_contex_t *last_q_ptr = list_last_entry(head, queue_contex_t, chain);
-    int size;
+    queue_t *first = queue_of(list_first_entry(head, queue_contex_t, chain)->q);
+    int size = 0, heap_values = 0, k = 0;
 
     list_for_each_entry (q_ptr, head, chain) {
-        if (q_ptr == last_q_ptr) {
-            list_splice_init(q_ptr->q, &ans);
-            break;
-        }
-
-        list_splice_init(q_ptr->q, &ans);
-        list_splice_init(last_q_ptr->q, &ans);
-        last_q_ptr = list_entry(last_q_ptr->chain.prev, queue_contex_t, chain);
+        queue_t *q = queue_of(q_ptr->q);
+
+        size += q->size;
+        heap_values += q->heap_values;
+        q->size = q->heap_values = 0;
+        index_invalidate(q);
+        k++;
+        /* The first queue takes over the storage of the elements it gets */
+        if (q != first)
+            slab_merge(first, q);
     }
 
-    q_sort(&ans, descend);
-    size = q_size(&ans);
-    list_splice_init(&ans, list_first_entry(head, queue_contex_t, chain)->q);
+    if (merge_mode == MERGE_PAIRWISE)
+        merge_pairwise(head, k, descend);
+    else
+        relink(&first->head, merge_by_heap(head, descend));
+    first->size = size;
+    first->heap_values = heap_values;
+    reordered(&first->head);
 
     return size;
 }
 
 /* Constructor of a node with data */
-element_t *new_node(char *s)
+element_t *new_node(queue_t *q, char *s)
 {
-    element_t *node = malloc(sizeof(element_t));
+    size_t len = strlen(s) + 1;
+    element_t *node = slab_alloc(q);
     if (!node)
         return NULL;
 
-    node->value = strdup(s);
-    if (__glibc_likely(!node->value)) {
-        free(node);
+    node->key = q_key(s);
+
+    /* Short strings live in the element itself */
+    if (len <= sizeof(node->buf)) {
+        node->value = memcpy(node->buf, s, len);
+        return node;
+    }
+
+    node->value = malloc(len);
+    if (__glibc_unlikely(!node->value)) {
+        node->value = node->buf;
+        q_release_element(node);
         return NULL;
     }
+    memcpy(node->value, s, len);
 
     return node;
 }
@@ -9,22 +9,116 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "harness.h"
 #include "list.h"
 
+/* Strings of up to Q_INLINE_LEN - 1 characters are stored inside the element
+ * so that inserting them takes a single allocation.
+ */
+#define Q_INLINE_LEN 24
+
+struct q_chunk;
+struct q_index;
+
 /**
  * element_t - Linked list element
  * @value: pointer to array holding string
  * @list: node of a doubly-linked list
+ * @key: first 8 bytes of @value packed in big-endian order, zero padded
+ * @chunk: the slab chunk this element was carved from
+ * @buf: inline storage for short strings
  *
- * @value needs to be explicitly allocated and freed
+ * @value either points to @buf or to a separately allocated string, which
+ * needs to be explicitly allocated and freed.
  */
 typedef struct {
     char *value;
     struct list_head list;
+    uint64_t key;
+    struct q_chunk *chunk;
+    char buf[Q_INLINE_LEN];
 } element_t;
 
+/**
+ * q_key() - Pack the prefix of a string into an element key
+ * @s: the string
+ *
+ * Comparing two keys as integers orders them like strcmp() orders their first
+ * 8 bytes.
+ */
+static inline uint64_t q_key(const char *s)
+{
+    uint64_t key = 0;
+    for (int i = 0; i < 8; i++) {
+        key <<= 8;
+        if (*s)
+            key |= (unsigned char) *s++;
+    }
+    return key;
+}
+
+/**
+ * q_compare() - Compare the values of two elements
+ * @a: element created by the q_* functions
+ * @b: element created by the q_* functions
+ *
+ * Most pairs are told apart by a single compare of their keys, and strcmp()
+ * only runs past the common prefix of 8 bytes.
+ *
+ * Return: negative, zero or positive like strcmp(a->value, b->value)
+ */
+static inline int q_compare(const element_t *a, const element_t *b)
+{
+    if (a->key != b->key)
+        return a->key < b->key ? -1 : 1;
+    /* Equal keys ending in a null byte mean equal strings */
+    if (!(a->key & 0xff))
+        return 0;
+    return strcmp(a->value + 8, b->value + 8);
+}
+
+/**
+ * queue_t - Header of a queue
+ * @head: list head linking the elements, must be the first member
+ * @size: number of elements currently linked to @head
+ * @heap_values: number of linked elements whose value is not inline
+ * @chunks: slab chunks owned by this queue
+ * @free_elems: released elements ready to be handed out again
+ * @index: skip list built by q_insert_sorted(), or NULL
+ * @shuffle_state: splitmix64 state of the shuffles of this queue
+ *
+ * q_new() hands out &queue->head, so every q_* function receiving the header
+ * of a queue can reach its cached length through queue_of().
+ *
+ * Elements are carved out of @chunks and go back to @free_elems when they
+ * are released, so q_free() releases the whole queue chunk by chunk instead
+ * of element by element.
+ */
+typedef struct {
+    struct list_head head;
+    int size;
+    int heap_values;
+    struct list_head chunks;
+    struct list_head free_elems;
+    struct q_index *index;
+    uintptr_t shuffle_state;
+} queue_t;
+
+/**
+ * queue_of() - Get the queue owning a header returned by q_new()
+ * @head: header of queue
+ *
+ * Must not be used on list heads which are not created by q_new(), such as
+ * the temporary lists declared with LIST_HEAD().
+ */
+static inline queue_t *queue_of(struct list_head *head)
+{
+    return list_entry(head, queue_t, head);
+}
+
 /**
  * queue_contex_t - The context managing a chain of queues
  * @q: pointer to the head of the queue
@@ -39,6 +133,41 @@ typedef struct {
     int id;
 } queue_contex_t;
 
+/* Algorithms q_sort() can use */
+enum {
+    SORT_TOP_DOWN,  /* recursive top-down merge sort */
+    SORT_BOTTOM_UP, /* iterative bottom-up merge sort */
+    SORT_PARALLEL,  /* bottom-up merge sort on sort_threads threads */
+    SORT_RADIX,     /* MSD radix sort on the key prefix, then merge sort */
+};
+
+/* Algorithm used by q_sort(), one of the SORT_* values */
+extern int sort_mode;
+
+/* Number of threads used by SORT_PARALLEL, at most PARALLEL_MAX_THREADS */
+#define PARALLEL_MAX_THREADS 64
+extern int sort_threads;
+
+/* Strategies of q_merge() */
+enum {
+    MERGE_HEAP,     /* k-way merge through a min-heap of the queue fronts */
+    MERGE_PAIRWISE, /* rounds of merging neighbouring queues */
+};
+
+/* Strategy used by q_merge(), one of the MERGE_* values */
+extern int merge_mode;
+
+/* Memory layouts of the elements of a queue */
+enum {
+    LAYOUT_LINKED,    /* elements stay in the slots they were allocated in */
+    LAYOUT_SEGMENTED, /* elements are moved into list order after reordering */
+};
+
+/* Layout kept by the operations which reorder a queue, one of the LAYOUT_*
+ * values.  It is meant to be chosen once at startup.
+ */
+extern int queue_layout;
+
 /* Operations on queue */
 
 /**
@@ -51,9 +180,27 @@ struct list_head *q_new();
 /**
  * q_free() - Free all storage used by queue, no effect if header is NULL
  * @head: header of queue
+ *
+ * Elements removed from this queue must be released with q_release_element()
+ * before the queue is freed, since their storage belongs to the queue.
  */
 void q_free(struct list_head *head);
 
+/**
+ * q_compact() - Move the elements into list order in memory
+ * @head: header of queue
+ *
+ * The elements are carved out of blocks of contiguous slots. This moves them
+ * so that the list order matches the order of the slots, block by block, which
+ * turns a traversal into a mostly sequential scan the hardware can prefetch.
+ * No memory is allocated. Elements removed from the queue must have been
+ * released, and pointers to elements of the queue are invalidated.
+ *
+ * With queue_layout set to LAYOUT_SEGMENTED, q_sort(), q_reverse(),
+ * q_reverseK(), q_swap() and q_merge() call this before they return.
+ */
+void q_compact(struct list_head *head);
+
 /**
  * q_insert_head() - Insert an element in the head
  * @head: header of queue
@@ -78,6 +225,52 @@ bool q_insert_head(struct list_head *head, char *s);
  */
 bool q_insert_tail(struct list_head *head, char *s);
 
+/**
+ * q_insert_tail_batch() - Insert a batch of elements at the tail
+ * @head: header of queue
+ * @sv: strings would be inserted
+ * @n: number of strings in @sv
+ * @reps: number of times the strings of @sv are inserted
+ *
+ * Insert @sv[0] to @sv[@n - 1] in order, @reps times over, so that a single
+ * string repeated many times is passed as @n == 1. Each element gets its own
+ * copy of the string, as with q_insert_tail(), but the elements and the copies
+ * are carved out of one allocation and linked into the queue at once.
+ * Either all the elements are inserted or none.
+ *
+ * Return: true for success, false for allocation failed or queue is NULL
+ */
+bool q_insert_tail_batch(struct list_head *head, char **sv, int n, int reps);
+
+/**
+ * q_insert_sorted() - Insert an element at its place in a sorted queue
+ * @head: header of queue
+ * @s: string would be inserted
+ * @descend: whether the queue is sorted in descending order
+ *
+ * The queue must be sorted in the given order, and stays sorted. The new
+ * element goes after the elements equal to it, like q_sort() would place it.
+ *
+ * The place is found through a skip list layered over the list, so inserting
+ * takes O(log n) expected time instead of inserting and sorting again. The
+ * index is built on the first call and kept up to date by further calls, but
+ * any other operation changing the queue drops it, and the next call builds
+ * it again in linear time. Its memory is released with the queue.
+ *
+ * Return: true for success, false for allocation failed or queue is NULL
+ */
+bool q_insert_sorted(struct list_head *head, char *s, bool descend);
+
+/**
+ * q_drop_index() - Drop the index of a queue reordered from outside
+ * @head: header of queue
+ *
+ * Must be called by code which reorders the elements of a queue without going
+ * through the q_* functions, such as list_sort() or q_shuffle(), so that
+ * q_insert_sorted() does not use a stale index. No memory is freed.
+ */
+void q_drop_index(struct list_head *head);
+
 /**
  * q_remove_head() - Remove the element from head of queue
  * @head: header of queue
@@ -108,22 +301,75 @@ element_t *q_remove_head(struct list_head *head, char *sp, size_t bufsize);
  */
 element_t *q_remove_tail(struct list_head *head, char *sp, size_t bufsize);
 
+/**
+ * q_remove_head_n() - Remove the first n elements of queue at once
+ * @head: header of queue
+ * @list: list the removed elements are moved to, in queue order
+ * @n: number of elements to remove
+ * @sp: packed buffer the removed strings are copied to, or NULL
+ * @bufsize: size of the buffer
+ *
+ * The removed elements are cut off the queue in one step. If sp is non-NULL,
+ * their strings are stored back to back in *sp, in the order q_remove_head()
+ * would have returned them, each followed by a null terminator. A string
+ * which does not fit in the rest of the buffer is truncated, and the strings
+ * after it are not copied.
+ *
+ * The elements are not freed. Pass @list to q_release_list() to discard them.
+ *
+ * Return: the number of elements removed, which is less than @n if the queue
+ * is shorter.
+ */
+int q_remove_head_n(struct list_head *head,
+                    struct list_head *list,
+                    int n,
+                    char *sp,
+                    size_t bufsize);
+
+/**
+ * q_remove_tail_n() - Remove the last n elements of queue at once
+ * @head: header of queue
+ * @list: list the removed elements are moved to, in queue order
+ * @n: number of elements to remove
+ * @sp: packed buffer the removed strings are copied to, or NULL
+ * @bufsize: size of the buffer
+ *
+ * Same as q_remove_head_n(), except that the strings are packed in the order
+ * q_remove_tail() would have returned them, starting from the tail.
+ *
+ * Return: the number of elements removed, which is less than @n if the queue
+ * is shorter.
+ */
+int q_remove_tail_n(struct list_head *head,
+                    struct list_head *list,
+                    int n,
+                    char *sp,
+                    size_t bufsize);
+
 /**
  * q_release_element() - Release the element
  * @e: element would be released
  *
+ * The element is returned to the slab of the queue it was allocated from.
  * This function is intended for internal use only.
  */
-static inline void q_release_element(element_t *e)
-{
-    test_free(e->value);
-    test_free(e);
-}
+void q_release_element(element_t *e);
+
+/**
+ * q_release_list() - Release a list of removed elements
+ * @list: list of elements removed from the same queue
+ *
+ * Equivalent to calling q_release_element() on every element, but the elements
+ * are handed back to the slab of their queue in one step. @list is left empty.
+ */
+void q_release_list(struct list_head *list);
 
 /**
  * q_size() - Get the size of the queue
  * @head: header of queue
  *
+ * The length is cached in the queue header, so this runs in constant time.
+ *
  * Return: the number of elements in queue, zero if queue is NULL or empty
  */
 int q_size(struct list_head *head);
@@ -143,6 +389,20 @@ int q_size(struct list_head *head);
  */
 bool q_delete_mid(struct list_head *head);
 
+/**
+ * q_delete_at() - Delete the node at the given fraction of the queue
+ * @head: header of queue
+ * @ratio: position of the node as a fraction of the size, from 0 to 1
+ *
+ * The node deleted is the ⌊ratio * n⌋th one using 0-based indexing, or the
+ * last one if @ratio is 1. A ratio of 0.5 deletes the same node as
+ * q_delete_mid(). The node is reached from the nearer end of the queue.
+ *
+ * Return: true for success, false if list is NULL or empty, or @ratio is out
+ * of range.
+ */
+bool q_delete_at(struct list_head *head, double ratio);
+
 /**
  * q_delete_dup() - Delete all nodes that have duplicate string,
  *                  leaving only distinct strings from the original queue.
@@ -155,6 +415,21 @@ bool q_delete_mid(struct list_head *head);
  */
 bool q_delete_dup(struct list_head *head);
 
+/**
+ * q_delete_dup_unsorted() - Delete all nodes that have duplicate string,
+ *                           wherever the copies are in the queue.
+ * @head: header of queue
+ *
+ * Unlike q_delete_dup(), the queue does not have to be sorted. The copies of
+ * every string are counted in a hash table, and the strings seen more than
+ * once are then removed in a single pass. The remaining nodes keep their
+ * order.
+ *
+ * Return: true for success, false if list is NULL or empty, or if the table
+ * could not be allocated.
+ */
+bool q_delete_dup_unsorted(struct list_head *head);
+
 /**
  * q_swap() - Swap every two adjacent nodes
  * @head: header of queue
@@ -196,7 +471,7 @@ void q_reverseK(struct list_head *head, int k);
  * @descend: whether or not to sort in descending order
  *
  * No effect if queue is NULL or empty. If there has only one element, do
- * nothing.
+ * nothing. The algorithm is selected by sort_mode, and all of them are stable.
  */
 void q_sort(struct list_head *head, bool descend);
 
@@ -206,7 +481,7 @@ void q_sort(struct list_head *head, bool descend);
  * @head: header of queue
  *
  * No effect if queue is NULL or empty. If there has only one element, do
- * nothing.
+ * nothing. The queue is scanned once, in linear time.
  *
  * Reference:
  * https://leetcode.com/problems/remove-nodes-from-linked-list/
@@ -221,7 +496,7 @@ int q_ascend(struct list_head *head);
  * @head: header of queue
  *
  * No effect if queue is NULL or empty. If there has only one element, do
- * nothing.
+ * nothing. The queue is scanned once, in linear time.
  *
  * Reference:
  * https://leetcode.com/problems/remove-nodes-from-linked-list/
@@ -243,6 +518,9 @@ int q_descend(struct list_head *head);
  * 'q' since they will be released externally. However, q_merge() is responsible
  * for making the queues to be NULL-queue, except the first one.
  *
+ * Either strategy takes O(N log k) time for N elements in k queues, and
+ * equal elements keep the order of the queues they come from.
+ *
  * Reference:
  * https://leetcode.com/problems/merge-k-sorted-lists/
  *
@@ -306,9 +306,10 @@ void init_time(double *timep)
 
 double delta_time(double *timep)
 {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    double current_time = tv.tv_sec + 1.0E-6 * tv.tv_usec;
+    struct timespec ts;
+    /* Unlike the time of day, the monotonic clock never jumps */
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double current_time = ts.tv_sec + 1.0E-9 * ts.tv_nsec;
     double delta = current_time - *timep;
     *timep = current_time;
     return delta;
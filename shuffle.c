@@ -1,8 +1,10 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "queue.h"
+#include "random.h"
 #include "shuffle.h"
 
 void q_shuffle(struct list_head *head)
@@ -10,6 +12,7 @@ void q_shuffle(struct list_head *head)
     if (!head || list_is_singular(head))
         return;
 
+    q_drop_index(head);
     struct list_head *completed = head;
     int cnt = q_size(head);
 
@@ -28,6 +31,131 @@ void q_shuffle(struct list_head *head)
     return;
 }
 
+/* Step the splitmix64 generator whose state is kept in the queue being
+ * shuffled, so queues shuffled on different threads do not share it.
+ */
+static inline uint32_t shuffle_next(uintptr_t *state)
+{
+    *state += (uintptr_t) 0x9e3779b97f4a7c15ULL;
+    return (uint32_t) (random_shuffle(*state) >> (M_INTPTR_SIZE * 8 - 32));
+}
+
+/* Uniform random integer in [0, n), by Lemire's multiply-and-reject method,
+ * which avoids the bias of taking a remainder.
+ */
+static uint32_t shuffle_bounded(uintptr_t *state, uint32_t n)
+{
+    uint64_t m = (uint64_t) shuffle_next(state) * n;
+
+    if ((uint32_t) m < n) {
+        uint32_t threshold = -n % n;
+        while ((uint32_t) m < threshold)
+            m = (uint64_t) shuffle_next(state) * n;
+    }
+    return m >> 32;
+}
+
+void q_shuffle_array(struct list_head *head)
+{
+    if (!head || list_empty(head) || list_is_singular(head))
+        return;
+
+    q_drop_index(head);
+    uintptr_t *state = &queue_of(head)->shuffle_state;
+    int cnt = q_size(head);
+    struct list_head **nodes = malloc(cnt * sizeof(struct list_head *));
+    if (!nodes) {
+        q_shuffle(head);
+        return;
+    }
+
+    struct list_head *node;
+    int i = 0;
+    list_for_each (node, head)
+        nodes[i++] = node;
+
+    for (i = cnt - 1; i > 0; i--) {
+        int j = shuffle_bounded(state, i + 1);
+        node = nodes[i];
+        nodes[i] = nodes[j];
+        nodes[j] = node;
+    }
+
+    /* Relink the nodes in their new order */
+    struct list_head *prev = head;
+    for (i = 0; i < cnt; i++) {
+        nodes[i]->prev = prev;
+        prev->next = nodes[i];
+        prev = nodes[i];
+    }
+    prev->next = head;
+    head->prev = prev;
+
+    free(nodes);
+}
+
+/* Shuffle the null-terminated list of n nodes recursively: shuffle both
+ * halves, then interleave them, taking the next node from a half with
+ * probability proportional to the nodes it has left.  Every interleaving is
+ * then equally likely, so the result is uniform.
+ */
+static struct list_head *merge_shuffle(struct list_head *list,
+                                       int n,
+                                       uintptr_t *state)
+{
+    if (n < 2)
+        return list;
+
+    int nl = n / 2, nr = n - nl;
+    struct list_head *mid = list;
+    for (int i = 1; i < nl; i++)
+        mid = mid->next;
+    struct list_head *right = mid->next;
+    mid->next = NULL;
+
+    struct list_head *left = merge_shuffle(list, nl, state);
+    right = merge_shuffle(right, nr, state);
+
+    struct list_head *head = NULL, **tail = &head;
+    while (nl && nr) {
+        if (shuffle_bounded(state, nl + nr) < (uint32_t) nl) {
+            *tail = left;
+            left = left->next;
+            nl--;
+        } else {
+            *tail = right;
+            right = right->next;
+            nr--;
+        }
+        tail = &(*tail)->next;
+    }
+    *tail = nl ? left : right;
+
+    return head;
+}
+
+void q_shuffle_merge(struct list_head *head)
+{
+    if (!head || list_empty(head) || list_is_singular(head))
+        return;
+
+    q_drop_index(head);
+    int cnt = q_size(head);
+    head->prev->next = NULL;
+    struct list_head *list =
+        merge_shuffle(head->next, cnt, &queue_of(head)->shuffle_state);
+
+    /* Rebuild the prev links */
+    struct list_head *prev = head;
+    for (struct list_head *node = list; node; node = node->next) {
+        node->prev = prev;
+        prev->next = node;
+        prev = node;
+    }
+    prev->next = head;
+    head->prev = prev;
+}
+
 void swap(struct list_head *n1, struct list_head *n2)
 {
     if (n1 == n2)
@@ -1,5 +1,18 @@
 #include "list.h"
 
+/* Shuffle by walking to a random node for every position, in O(n^2) time */
 void q_shuffle(struct list_head *head);
 
+/* Fisher–Yates shuffle of an array of the nodes, which are then relinked in
+ * one pass, in O(n) time.  Falls back to q_shuffle() if the array cannot be
+ * allocated.
+ */
+void q_shuffle_array(struct list_head *head);
+
+/* Merge shuffle, which splits the list in halves, shuffles them recursively
+ * and interleaves them at random.  Takes O(n log n) time and no memory other
+ * than O(log n) stack.
+ */
+void q_shuffle_merge(struct list_head *head);
+
 void swap(struct list_head *n1, struct list_head *n2);
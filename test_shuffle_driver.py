@@ -1,26 +1,37 @@
 import subprocess
 import re
 import random
+import sys
+import tempfile
 from itertools import permutations
 import random
 import matplotlib.pyplot as plt
 import numpy as np
 
+# Optional arguments: shuffle mode passed to the shuffle command, e.g. "walk"
+# or "merge", and the number of elements to shuffle, from 2 to 9
+mode = sys.argv[1] if len(sys.argv) > 1 else ""
+n = int(sys.argv[2]) if len(sys.argv) > 2 else 4
+elements = [str(i) for i in range(1, n + 1)]
+
 test_count = 1000000
-input = "new\nit 1\nit 2\nit 3\nit 4\n"
-for i in range(test_count):
-    input += "shuffle\n"
+input = "new\n" + "".join("it %s\n" % e for e in elements)
+input += ("shuffle %s\n" % mode) * test_count
 input += "free\nquit\n"
 
-
-command='./qtest -v 3'
-clist = command.split()
-completedProcess = subprocess.run(clist, capture_output=True, text=True, input=input)
+# Commands read from a file skip the line editing and history of stdin
+with tempfile.NamedTemporaryFile("w", suffix=".cmd") as cmd_file:
+    cmd_file.write(input)
+    cmd_file.flush()
+    command = './qtest -v 3 -f ' + cmd_file.name
+    clist = command.split()
+    completedProcess = subprocess.run(clist, capture_output=True, text=True)
 s = completedProcess.stdout
-startIdx = s.find("l = [1 2 3 4]") 
+initial = "l = [%s]" % " ".join(elements)
+startIdx = s.find(initial)
 endIdx = s.find("l = NULL")
-s = s[startIdx + 14 : endIdx]
-Regex = re.compile(r'\d \d \d \d')
+s = s[startIdx + len(initial) + 1 : endIdx]
+Regex = re.compile(" ".join([r'\d'] * n))
 result = Regex.findall(s)
 
 def permute(nums):
@@ -37,7 +48,7 @@ for i in result:
 
 
 counterSet = {}
-shuffle_array = ['1', '2', '3', '4']
+shuffle_array = elements
 s = permute(shuffle_array)
 
 
@@ -60,6 +71,13 @@ print("Expectation: ", expectation)
 print("Observation: ", counterSet)
 print("chi square sum: ", chiSquaredSum)
 
+# Critical value at the 5% significance level, by the Wilson-Hilferty
+# approximation of the chi-square distribution
+df = len(counterSet) - 1
+critical = df * (1 - 2 / (9 * df) + 1.645 * (2 / (9 * df)) ** 0.5) ** 3
+print("critical value (p = 0.05): ", critical)
+print("uniform" if chiSquaredSum < critical else "NOT uniform")
+
 permutations = counterSet.keys()
 counts = counterSet.values()
 
@@ -0,0 +1,41 @@
+# Test if q_ascend and q_descend run in linear time on 1M ordered strings
+option fail 0
+option malloc 0
+new
+it a 250000
+it b 250000
+it c 250000
+it d 250000
+time
+ascend
+descend
+time
+free
+new
+ih a 250000
+ih b 250000
+ih c 250000
+ih d 250000
+time
+descend
+ascend
+time
+size
+free
+new
+ih a 1
+ih b 100000
+ih c 100000
+ih d 100000
+ih e 100000
+ih f 100000
+ih g 100000
+ih h 100000
+ih i 100000
+ih j 100000
+ih k 100000
+time
+ascend
+time
+size
+free
@@ -0,0 +1,31 @@
+# Compare sort-then-dedup with the hash-based dedup on 1M random strings
+# The sorted input is built by merging four sorted queues, to keep every
+# single sort well within the time limit.
+option fail 0
+option malloc 0
+new
+it RAND 250000
+new
+it RAND 250000
+new
+it RAND 250000
+new
+it RAND 250000
+time
+sort
+prev
+sort
+prev
+sort
+prev
+sort
+merge
+dedup
+time
+free
+new
+it RAND 1000000
+time
+dedup -u
+time
+free
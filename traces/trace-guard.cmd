@@ -0,0 +1,30 @@
+# Run queue operations with every malloced block placed against a guard page,
+# so that a write past the end of a block faults at once.
+option fail 0
+option malloc 0
+option guard 1
+new
+ih RAND 2000
+it aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa 500
+ih dolphin
+it gerbil
+dedup -u
+shuffle
+sort
+is RAND 500
+rh
+rhn 100
+rt
+dm
+new
+ih RAND 1000
+sort
+merge
+free
+option guard 0
+new
+ih RAND 1000
+option fill 64
+it bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb 100
+free
+option fill -1
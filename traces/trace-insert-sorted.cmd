@@ -0,0 +1,174 @@
+# Keep a queue sorted while it grows in batches: insert then sort again,
+# against inserting each element at its place.  Run with 'option verbose 2'
+# to see the time taken by each approach.
+option fail 0
+option malloc 0
+new
+time
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+it RAND 2000
+sort
+time
+free
+new
+time
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+is RAND 2000
+time
+option descend 1
+sort
+is RAND 2000
+sort
+is RAND 2000
+sort
+is RAND 2000
+sort
+is RAND 2000
+sort
+is RAND 2000
+free
@@ -0,0 +1,19 @@
+# Time traversals of a sorted queue, whose elements are scattered in memory
+# unless qtest runs with -s.  Compare 'qtest -f' with 'qtest -s -f'.
+option fail 0
+option malloc 0
+new
+ih RAND 500000
+sort
+time
+reverse
+reverse
+reverse
+reverse
+reverse
+reverse
+reverse
+reverse
+dedup
+time
+free
@@ -0,0 +1,16 @@
+# Reproducible malloc failures: a fixed allocation, every n-th allocation,
+# and random failures from a fixed seed.
+option fail 100
+new
+option malloc_nth 3
+ih a 5
+option malloc_nth 0
+option malloc_every 4
+it b 8
+option malloc_every 0
+option malloc_seed 42
+option malloc 30
+ih RAND 20
+option malloc 0
+option malloc_seed 0
+free
@@ -0,0 +1,16 @@
+# Show where the queue operations allocate memory, per call site of malloc.
+option fail 0
+option malloc 0
+memstat reset
+new
+ih RAND 10000
+it aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa 1000
+it b 5000
+dedup -u
+shuffle
+sort
+is RAND 1000
+rhn 2000
+memstat
+free
+memstat
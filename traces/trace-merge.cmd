@@ -0,0 +1,1548 @@
+# Merge 256 sorted queues of random strings with each merge strategy
+option fail 0
+option malloc 0
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+time
+merge
+time
+free
+option merge 1
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+new
+ih RAND 500
+sort
+time
+merge
+time
+free
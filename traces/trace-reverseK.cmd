@@ -0,0 +1,15 @@
+# Test performance of reverseK on 2M elements with several group sizes
+option fail 0
+option malloc 0
+new
+ih dolphin 1000000
+it gerbil 1000000
+time
+reverseK 2
+reverseK 3
+reverseK 16
+reverseK 1000
+reverseK 1999999
+reverseK 2000000
+time
+free
@@ -1,3 +1,4 @@
+# Compare the sorting algorithms on the same amount of random strings
 option fail 0
 option malloc 0
 new
@@ -5,3 +6,25 @@ ih RAND 100000
 time
 sort
 time
+free
+option sort 1
+new
+ih RAND 100000
+time
+sort
+time
+free
+new
+ih RAND 100000
+time
+lsort
+time
+free
+option sort 3
+new
+ih RAND 100000
+time
+sort
+time
+free
+option sort 0
@@ -0,0 +1,18 @@
+# Collect the latency of every command, then show and export percentiles.
+option fail 0
+option malloc 0
+stats reset
+new
+ih RAND 1000
+it RAND 1000
+rh
+rh
+rt
+reverse
+sort
+size
+dm
+swap
+stats
+stats json
+free
@@ -0,0 +1,12 @@
+# Run queue operations on several threads at once, checking that the blocks
+# allocated by every thread are freed, possibly by another thread.
+option fail 0
+option malloc 0
+stress
+stress 8 20000
+option sort 2
+stress 3 50000
+option sort 0
+option guard 1
+stress 4 2000
+option guard 0